@@ -0,0 +1,139 @@
+#pragma once
+
+#include <nodes/NodeData>
+#include <nodes/NodeDataModel>
+
+using QtNodes::NodeData;
+using QtNodes::NodeDataModel;
+using QtNodes::NodeDataType;
+using QtNodes::PortIndex;
+using QtNodes::PortType;
+
+/// 与计算器示例中的 DecimalData 相同, 只是不依赖示例的代码
+class BenchmarkData : public NodeData {
+   public:
+    explicit BenchmarkData(double number = 0.0) : _number(number) {}
+
+    NodeDataType type() const override {
+        return NodeDataType{"decimal", "实数"};
+    }
+
+    double number() const { return _number; }
+
+   private:
+    double _number;
+};
+
+/// 只有一个输出端口, 由基准测试直接设置它的值
+class BenchmarkSourceModel : public NodeDataModel {
+   public:
+    QString caption() const override { return QStringLiteral("输入"); }
+
+    QString name() const override { return QStringLiteral("BenchmarkSource"); }
+
+    unsigned int nPorts(PortType portType) const override {
+        return (portType == PortType::Out) ? 1 : 0;
+    }
+
+    NodeDataType dataType(PortType, PortIndex) const override {
+        return BenchmarkData().type();
+    }
+
+    void setInData(std::shared_ptr<NodeData>, PortIndex) override {}
+
+    std::shared_ptr<NodeData> outData(PortIndex) override { return _number; }
+
+    QWidget *embeddedWidget() override { return nullptr; }
+
+    bool threadSafe() const override { return true; }
+
+    void setNumber(double number) {
+        _number = std::make_shared<BenchmarkData>(number);
+
+        Q_EMIT dataUpdated(0);
+    }
+
+   private:
+    std::shared_ptr<BenchmarkData> _number =
+        std::make_shared<BenchmarkData>();
+};
+
+/// 一进一出, 把输入加一之后输出
+class BenchmarkRelayModel : public NodeDataModel {
+   public:
+    QString caption() const override { return QStringLiteral("加一"); }
+
+    QString name() const override { return QStringLiteral("BenchmarkRelay"); }
+
+    unsigned int nPorts(PortType) const override { return 1; }
+
+    NodeDataType dataType(PortType, PortIndex) const override {
+        return BenchmarkData().type();
+    }
+
+    void setInData(std::shared_ptr<NodeData> data, PortIndex) override {
+        auto number = std::dynamic_pointer_cast<BenchmarkData>(data);
+
+        if (number)
+            _result = std::make_shared<BenchmarkData>(number->number() + 1.0);
+        else
+            _result.reset();
+
+        Q_EMIT dataUpdated(0);
+    }
+
+    std::shared_ptr<NodeData> outData(PortIndex) override { return _result; }
+
+    QWidget *embeddedWidget() override { return nullptr; }
+
+    bool threadSafe() const override { return true; }
+
+   private:
+    std::shared_ptr<BenchmarkData> _result;
+};
+
+/// 与计算器示例中的加法节点相同
+class BenchmarkSumModel : public NodeDataModel {
+   public:
+    QString caption() const override { return QStringLiteral("加法"); }
+
+    QString name() const override { return QStringLiteral("BenchmarkSum"); }
+
+    unsigned int nPorts(PortType portType) const override {
+        return (portType == PortType::In) ? 2 : 1;
+    }
+
+    NodeDataType dataType(PortType, PortIndex) const override {
+        return BenchmarkData().type();
+    }
+
+    void setInData(std::shared_ptr<NodeData> data,
+                   PortIndex portIndex) override {
+        auto number = std::dynamic_pointer_cast<BenchmarkData>(data);
+
+        if (portIndex == 0)
+            _number1 = number;
+        else
+            _number2 = number;
+
+        if (_number1 && _number2)
+            _result = std::make_shared<BenchmarkData>(_number1->number() +
+                                                      _number2->number());
+        else
+            _result.reset();
+
+        Q_EMIT dataUpdated(0);
+    }
+
+    std::shared_ptr<NodeData> outData(PortIndex) override { return _result; }
+
+    QWidget *embeddedWidget() override { return nullptr; }
+
+    bool threadSafe() const override { return true; }
+
+   private:
+    std::shared_ptr<BenchmarkData> _number1;
+    std::shared_ptr<BenchmarkData> _number2;
+
+    std::shared_ptr<BenchmarkData> _result;
+};
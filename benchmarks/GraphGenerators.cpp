@@ -0,0 +1,121 @@
+#include "GraphGenerators.hpp"
+
+#include <algorithm>
+#include <random>
+
+namespace {
+
+using ModelKind = GraphSpec::ModelKind;
+
+/// source -> relay -> relay -> ...
+void generateChain(GraphSpec &spec, std::size_t nodeCount) {
+    for (std::size_t i = 1; i < nodeCount; ++i) {
+        spec.nodes.push_back(ModelKind::Relay);
+        spec.edges.push_back({i - 1, i, 0});
+    }
+}
+
+/// 所有 relay 都直接连在 source 上
+void generateFanOut(GraphSpec &spec, std::size_t nodeCount) {
+    for (std::size_t i = 1; i < nodeCount; ++i) {
+        spec.nodes.push_back(ModelKind::Relay);
+        spec.edges.push_back({0, i, 0});
+    }
+}
+
+/// 一串菱形: top -> (left, right) -> sum, sum 又是下一个菱形的 top
+void generateDiamonds(GraphSpec &spec, std::size_t nodeCount) {
+    std::size_t top = 0;
+
+    while (spec.nodes.size() + 3 <= nodeCount) {
+        std::size_t const left = spec.nodes.size();
+        std::size_t const right = left + 1;
+        std::size_t const sum = left + 2;
+
+        spec.nodes.push_back(ModelKind::Relay);
+        spec.nodes.push_back(ModelKind::Relay);
+        spec.nodes.push_back(ModelKind::Sum);
+
+        spec.edges.push_back({top, left, 0});
+        spec.edges.push_back({top, right, 0});
+        spec.edges.push_back({left, sum, 0});
+        spec.edges.push_back({right, sum, 1});
+
+        top = sum;
+    }
+}
+
+/// 每个 sum 节点的两个输入分别来自随机选出的一个更早的节点
+void generateRandomDag(GraphSpec &spec, std::size_t nodeCount,
+                       unsigned int seed) {
+    std::mt19937 random(seed);
+
+    for (std::size_t i = 1; i < nodeCount; ++i) {
+        spec.nodes.push_back(ModelKind::Sum);
+
+        std::uniform_int_distribution<std::size_t> pick(0, i - 1);
+
+        spec.edges.push_back({pick(random), i, 0});
+        spec.edges.push_back({pick(random), i, 1});
+    }
+}
+}  // namespace
+
+QString graphShapeName(GraphShape shape) {
+    switch (shape) {
+        case GraphShape::Chain:
+            return QStringLiteral("chain");
+
+        case GraphShape::FanOut:
+            return QStringLiteral("fanout");
+
+        case GraphShape::Diamond:
+            return QStringLiteral("diamond");
+
+        case GraphShape::RandomDag:
+            return QStringLiteral("random");
+    }
+
+    return QString();
+}
+
+bool graphShapeFromName(QString const &name, GraphShape &shape) {
+    for (GraphShape candidate : {GraphShape::Chain, GraphShape::FanOut,
+                                 GraphShape::Diamond, GraphShape::RandomDag}) {
+        if (graphShapeName(candidate) == name) {
+            shape = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+GraphSpec generateGraph(GraphShape shape, std::size_t nodeCount,
+                        unsigned int seed) {
+    GraphSpec spec;
+
+    spec.nodes.push_back(ModelKind::Source);
+
+    nodeCount = std::max<std::size_t>(nodeCount, 1);
+
+    switch (shape) {
+        case GraphShape::Chain:
+            generateChain(spec, nodeCount);
+            break;
+
+        case GraphShape::FanOut:
+            generateFanOut(spec, nodeCount);
+            break;
+
+        case GraphShape::Diamond:
+            generateDiamonds(spec, nodeCount);
+            break;
+
+        case GraphShape::RandomDag:
+            generateRandomDag(spec, nodeCount, seed);
+            break;
+    }
+
+    return spec;
+}
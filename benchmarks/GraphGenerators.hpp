@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QtCore/QString>
+#include <cstddef>
+#include <vector>
+
+/// 基准测试用的合成图. 只描述图的形状, 由调用者负责创建节点和连接,
+/// 这样创建节点和创建连接可以分别计时
+struct GraphSpec {
+    enum class ModelKind { Source, Relay, Sum };
+
+    struct Edge {
+        std::size_t out;
+        std::size_t in;
+        int inPort;
+    };
+
+    /// 节点 0 总是唯一的输入节点, 边总是从编号小的节点连向编号大的节点
+    std::vector<ModelKind> nodes;
+
+    std::vector<Edge> edges;
+};
+
+enum class GraphShape { Chain, FanOut, Diamond, RandomDag };
+
+QString graphShapeName(GraphShape shape);
+
+/// 按名字查找形状, 找不到时返回 false
+bool graphShapeFromName(QString const &name, GraphShape &shape);
+
+/// 生成大约 nodeCount 个节点的图, seed 只影响随机DAG
+GraphSpec generateGraph(GraphShape shape, std::size_t nodeCount,
+                        unsigned int seed = 1);
@@ -0,0 +1,257 @@
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtGui/QImage>
+#include <QtGui/QPainter>
+#include <QtWidgets/QApplication>
+#include <nodes/Connection>
+#include <nodes/DataModelRegistry>
+#include <nodes/FlowScene>
+#include <nodes/FlowView>
+#include <nodes/Node>
+#include <functional>
+#include <iostream>
+
+#include "BenchmarkModels.hpp"
+#include "GraphGenerators.hpp"
+
+using QtNodes::DataModelRegistry;
+using QtNodes::FlowScene;
+using QtNodes::FlowView;
+using QtNodes::Node;
+
+namespace {
+
+struct Options {
+    std::vector<std::size_t> sizes{1000, 10000, 100000};
+
+    std::vector<GraphShape> shapes{GraphShape::Chain, GraphShape::FanOut,
+                                   GraphShape::Diamond, GraphShape::RandomDag};
+
+    bool headless = false;
+};
+
+std::shared_ptr<DataModelRegistry> registerDataModels() {
+    auto ret = std::make_shared<DataModelRegistry>();
+
+    ret->registerModel<BenchmarkSourceModel>();
+    ret->registerModel<BenchmarkRelayModel>();
+    ret->registerModel<BenchmarkSumModel>();
+
+    return ret;
+}
+
+std::unique_ptr<NodeDataModel> createModel(GraphSpec::ModelKind kind) {
+    switch (kind) {
+        case GraphSpec::ModelKind::Source:
+            return std::make_unique<BenchmarkSourceModel>();
+
+        case GraphSpec::ModelKind::Relay:
+            return std::make_unique<BenchmarkRelayModel>();
+
+        case GraphSpec::ModelKind::Sum:
+            return std::make_unique<BenchmarkSumModel>();
+    }
+
+    return nullptr;
+}
+
+double measure(std::function<void()> const &operation) {
+    QElapsedTimer timer;
+    timer.start();
+
+    operation();
+
+    return static_cast<double>(timer.nsecsElapsed()) / 1.0e6;
+}
+
+/// 生成一个图并依次测量所有操作, 每个操作输出一条结果
+void runBenchmark(GraphShape shape, std::size_t nodeCount,
+                  Options const &options,
+                  std::shared_ptr<DataModelRegistry> const &registry,
+                  QJsonArray &results) {
+    GraphSpec const spec = generateGraph(shape, nodeCount);
+
+    auto record = [&](QString const &operation, double milliseconds) {
+        QJsonObject result;
+        result["shape"] = graphShapeName(shape);
+        result["nodes"] = static_cast<qint64>(spec.nodes.size());
+        result["connections"] = static_cast<qint64>(spec.edges.size());
+        result["headless"] = options.headless;
+        result["operation"] = operation;
+        result["milliseconds"] = milliseconds;
+
+        results.append(result);
+
+        std::cerr << qPrintable(graphShapeName(shape)) << " "
+                  << spec.nodes.size() << " " << qPrintable(operation) << ": "
+                  << milliseconds << " ms" << std::endl;
+    };
+
+    // 同步模式中每个菱形都会让下游的传播次数翻倍, 所以统一在 flush() 中
+    // 按拓扑顺序传播, 每个节点只传播一次
+    FlowScene scene(registry);
+    scene.setHeadless(options.headless);
+    scene.setPropagationMode(FlowScene::PropagationMode::Deferred);
+
+    std::vector<Node *> nodes;
+    nodes.reserve(spec.nodes.size());
+
+    record("createNode", measure([&]() {
+               for (auto kind : spec.nodes)
+                   nodes.push_back(&scene.createNode(createModel(kind)));
+           }));
+
+    // 排成网格, 渲染时视口里能看到一部分节点
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        scene.setNodePosition(*nodes[i],
+                              QPointF((i % 100) * 200.0, (i / 100) * 150.0));
+    }
+
+    record("createConnection", measure([&]() {
+               for (auto const &edge : spec.edges) {
+                   scene.createConnection(*nodes[edge.in], edge.inPort,
+                                          *nodes[edge.out], 0);
+               }
+
+               scene.flush();
+           }));
+
+    auto source =
+        static_cast<BenchmarkSourceModel *>(nodes.front()->nodeDataModel());
+
+    record("propagate", measure([&]() {
+               source->setNumber(1.0);
+               scene.flush();
+           }));
+
+    if (!options.headless) {
+        FlowView view(&scene);
+        view.resize(1280, 720);
+        view.centerOn(QPointF(0.0, 0.0));
+
+        QImage image(view.size(), QImage::Format_ARGB32_Premultiplied);
+
+        record("render", measure([&]() {
+                   QPainter painter(&image);
+                   view.render(&painter);
+               }));
+    }
+
+    QByteArray data;
+
+    record("saveToMemory", measure([&]() { data = scene.saveToMemory(); }));
+
+    FlowScene loaded(registry);
+    loaded.setHeadless(options.headless);
+    loaded.setPropagationMode(FlowScene::PropagationMode::Deferred);
+
+    record("loadFromMemory", measure([&]() {
+               loaded.loadFromMemory(data);
+               loaded.flush();
+           }));
+
+    record("clearScene", measure([&]() { loaded.clearScene(); }));
+
+    record("saveToMemoryBinary", measure([&]() {
+               data = scene.saveToMemory(FlowScene::SceneFormat::Binary);
+           }));
+
+    record("loadFromMemoryBinary", measure([&]() {
+               loaded.loadFromMemory(data);
+               loaded.flush();
+           }));
+
+    loaded.clearScene();
+}
+
+bool parseOptions(QCommandLineParser &parser, Options &options) {
+    if (parser.isSet("sizes")) {
+        options.sizes.clear();
+
+        for (auto const &size : parser.value("sizes").split(',')) {
+            bool ok = false;
+            options.sizes.push_back(size.toULongLong(&ok));
+
+            if (!ok) {
+                std::cerr << "Invalid size: " << qPrintable(size) << std::endl;
+                return false;
+            }
+        }
+    }
+
+    if (parser.isSet("shapes")) {
+        options.shapes.clear();
+
+        for (auto const &name : parser.value("shapes").split(',')) {
+            GraphShape shape;
+
+            if (!graphShapeFromName(name, shape)) {
+                std::cerr << "Unknown shape: " << qPrintable(name) << std::endl;
+                return false;
+            }
+
+            options.shapes.push_back(shape);
+        }
+    }
+
+    options.headless = parser.isSet("headless");
+
+    return true;
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    // 默认在没有显示器的环境中运行
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Times scene operations on synthetic graphs and prints the results "
+        "as JSON.");
+    parser.addHelpOption();
+    parser.addOption({"sizes", "Comma separated node counts.", "sizes"});
+    parser.addOption(
+        {"shapes", "Comma separated shapes: chain, fanout, diamond, random.",
+         "shapes"});
+    parser.addOption({"headless", "Run the scenes without graphics items."});
+    parser.addOption({"output", "Write the results to a file.", "file"});
+    parser.process(app);
+
+    Options options;
+
+    if (!parseOptions(parser, options)) return 1;
+
+    auto registry = registerDataModels();
+
+    QJsonArray results;
+
+    for (GraphShape shape : options.shapes) {
+        for (std::size_t size : options.sizes)
+            runBenchmark(shape, size, options, registry, results);
+    }
+
+    QByteArray const json = QJsonDocument(results).toJson();
+
+    if (parser.isSet("output")) {
+        QFile file(parser.value("output"));
+
+        if (!file.open(QIODevice::WriteOnly)) {
+            std::cerr << "Cannot write " << qPrintable(parser.value("output"))
+                      << std::endl;
+            return 1;
+        }
+
+        file.write(json);
+    } else {
+        std::cout << json.constData();
+    }
+
+    return 0;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <nodes/NodeDataModel>
 
 using QtNodes::NodeData;
@@ -21,6 +22,16 @@ class DecimalData : public NodeData {
 
     QString numberAsText() const { return QString::number(_number, 'f'); }
 
+    std::optional<std::size_t> hash() const override {
+        return std::hash<double>()(_number);
+    }
+
+    bool equals(NodeData const &nodeData) const override {
+        return static_cast<DecimalData const &>(nodeData)._number == _number;
+    }
+
+    std::size_t byteSize() const override { return sizeof(*this); }
+
    private:
     double _number;
 };
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <nodes/NodeDataModel>
 
 using QtNodes::NodeData;
@@ -21,6 +22,16 @@ class IntegerData : public NodeData {
 
     QString numberAsText() const { return QString::number(_number); }
 
+    std::optional<std::size_t> hash() const override {
+        return std::hash<int>()(_number);
+    }
+
+    bool equals(NodeData const &nodeData) const override {
+        return static_cast<IntegerData const &>(nodeData)._number == _number;
+    }
+
+    std::size_t byteSize() const override { return sizeof(*this); }
+
    private:
     int _number;
 };
@@ -37,6 +37,10 @@ class MathOperationDataModel : public NodeDataModel {
 
     QWidget* embeddedWidget() override { return nullptr; }
 
+    [[nodiscard]] bool threadSafe() const override { return true; }
+
+    [[nodiscard]] bool memoizeInputs() const override { return true; }
+
     [[nodiscard]] NodeValidationState validationState() const override;
 
     [[nodiscard]] QString validationMessage() const override;
@@ -45,8 +49,8 @@ class MathOperationDataModel : public NodeDataModel {
     virtual void compute() = 0;
 
    protected:
-    std::weak_ptr<DecimalData> _number1;
-    std::weak_ptr<DecimalData> _number2;
+    std::shared_ptr<DecimalData> _number1;
+    std::shared_ptr<DecimalData> _number2;
 
     std::shared_ptr<DecimalData> _result;
 
@@ -49,8 +49,8 @@ void ModuloModel::setInData(std::shared_ptr<NodeData> data,
     {
         PortIndex const outPortIndex = 0;
 
-        auto n1 = _number1.lock();
-        auto n2 = _number2.lock();
+        auto n1 = _number1;
+        auto n2 = _number2;
 
         if (n2 && (n2->number() == 0.0)) {
             modelValidationState = NodeValidationState::Error;
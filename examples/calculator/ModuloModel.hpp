@@ -65,13 +65,15 @@ class ModuloModel : public NodeDataModel {
 
     QWidget* embeddedWidget() override { return nullptr; }
 
+    bool memoizeInputs() const override { return true; }
+
     NodeValidationState validationState() const override;
 
     QString validationMessage() const override;
 
    private:
-    std::weak_ptr<IntegerData> _number1;
-    std::weak_ptr<IntegerData> _number2;
+    std::shared_ptr<IntegerData> _number1;
+    std::shared_ptr<IntegerData> _number2;
 
     std::shared_ptr<IntegerData> _result;
 
@@ -22,8 +22,8 @@ class MultiplicationModel : public MathOperationDataModel {
     void compute() override {
         PortIndex const outPortIndex = 0;
 
-        auto n1 = _number1.lock();
-        auto n2 = _number2.lock();
+        auto n1 = _number1;
+        auto n2 = _number2;
 
         if (n1 && n2) {
             modelValidationState = NodeValidationState::Valid;
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QJsonObject>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QTimer>
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "EntityId.hpp"
+#include "Export.hpp"
+
+namespace QtNodes {
+
+class Connection;
+
+class FlowScene;
+
+class Node;
+
+/// 增量自动保存.
+/// 场景的每次修改 (节点的创建/删除/移动, 连接的创建/删除, 模型 serialize()
+/// 结果的变化) 都作为一行追加到日志文件 fileName + ".journal" 中, 不需要
+/// 重新序列化整个场景. 日志超过 compactionThreshold() 后, 在工作线程中把它
+/// 合并进快照文件 fileName (二进制场景格式), 然后重新开始一段新日志.
+/// 程序崩溃后用 recover() 从快照和日志还原场景.
+///
+/// 模型在 dataUpdated 或 stateChanged 之后重新序列化,
+/// 移动和模型的变化会合并, 每个节点在 flushInterval() 毫秒内最多写一次.
+/// 日志是场景的子对象, 随场景一起销毁
+class NODE_EDITOR_PUBLIC ChangeJournal : public QObject {
+    Q_OBJECT
+
+   public:
+    ChangeJournal(FlowScene &scene, QString fileName);
+
+    /// 写出尚未写入的修改
+    ~ChangeJournal() override;
+
+   public:
+    /// 把当前场景写成快照, 清空日志, 之后开始记录修改.
+    /// 后台合并尚未完成时返回 false
+    bool start();
+
+    /// 写出尚未写入的修改并停止记录, 快照和日志保留
+    void stop();
+
+    bool isRecording() const;
+
+    /// 把尚未写入的修改写到日志文件
+    void flush();
+
+    /// 在工作线程中把日志合并进快照. 已经在合并时不做任何事
+    void compact();
+
+    QString fileName() const;
+
+    int flushInterval() const;
+
+    void setFlushInterval(int milliseconds);
+
+    qint64 compactionThreshold() const;
+
+    void setCompactionThreshold(qint64 bytes);
+
+    /// 把快照和日志还原到 scene 中. 最后一行可能只写了一半, 会被忽略
+    static bool recover(FlowScene &scene, QString const &fileName);
+
+   Q_SIGNALS:
+    void compacted(bool success);
+
+   private:
+    void watchNode(Node &node);
+
+    void onNodeCreated(Node &node);
+
+    void onNodeDeleted(Node &node);
+
+    void onConnectionCreated(Connection const &connection);
+
+    void onConnectionDeleted(Connection const &connection);
+
+    void onBatchCommitted(std::vector<Node *> const &nodes,
+                          std::vector<Connection *> const &connections);
+
+    /// 先写出合并中的移动和模型变化, 保证日志中的顺序
+    void append(QByteArray const &line);
+
+    void writeCoalesced();
+
+    /// 把缓冲区写到文件, 不检查是否需要合并
+    void writeBuffer();
+
+    void scheduleFlush();
+
+    bool openJournal(QIODevice::OpenMode mode);
+
+    void finishCompaction(bool success);
+
+   private:
+    FlowScene &_scene;
+
+    QString _fileName;
+
+    QFile _journal;
+
+    bool _recording = false;
+
+    bool _compacting = false;
+
+    QTimer _flushTimer;
+
+    qint64 _compactionThreshold = 4 * 1024 * 1024;
+
+    /// 尚未写到文件中的日志行
+    QByteArray _buffer;
+
+    std::unordered_set<Node *> _movedNodes;
+
+    std::unordered_set<Node *> _changedModels;
+
+    /// 每个节点最后写入的模型数据, 用来跳过没有变化的模型
+    std::unordered_map<EntityId, QJsonObject> _modelStates;
+};
+}  // namespace QtNodes
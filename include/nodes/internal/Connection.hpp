@@ -6,6 +6,7 @@
 
 #include "ConnectionGeometry.hpp"
 #include "ConnectionState.hpp"
+#include "EntityId.hpp"
 #include "Export.hpp"
 #include "NodeData.hpp"
 #include "PortType.hpp"
@@ -48,8 +49,12 @@ class NODE_EDITOR_PUBLIC Connection : public QObject, public Serializable {
     QJsonObject serialize() const override;
 
    public:
+    /// 持久标识, 第一次调用时才生成
     QUuid id() const;
 
+    /// 运行时标识, 创建连接时分配
+    EntityId entityId() const { return _entityId; }
+
     /// Remembers the end being dragged.
     /// Invalidates Node address.
     /// Grabs mouse.
@@ -66,7 +71,14 @@ class NODE_EDITOR_PUBLIC Connection : public QObject, public Serializable {
 
     void removeFromNodes() const;
 
+    /// 从两端节点上移除并忘掉它们. 之后析构连接不再向下游发送空数据,
+    /// 也不再重绘节点, 用于两端节点即将一起删除的情况
+    void detachFromNodes();
+
    public:
+    /// headless 场景中的连接没有图形对象
+    bool hasGraphicsObject() const;
+
     ConnectionGraphicsObject &getConnectionGraphicsObject() const;
 
     ConnectionState const &connectionState() const;
@@ -89,9 +101,15 @@ class NODE_EDITOR_PUBLIC Connection : public QObject, public Serializable {
 
     void setTypeConverter(TypeConverter converter);
 
+    bool hasTypeConverter() const;
+
     bool complete() const;
 
    public:  // data propagation
+    /// 用连接上的类型转换器转换数据, 没有转换器时原样返回
+    std::shared_ptr<NodeData> convertData(
+        std::shared_ptr<NodeData> nodeData) const;
+
     void transmitData(std::shared_ptr<NodeData> nodeData) const;
 
     void transmitEmptyData() const;
@@ -103,7 +121,9 @@ class NODE_EDITOR_PUBLIC Connection : public QObject, public Serializable {
     void connectionMadeIncomplete(Connection const &) const;
 
    private:
-    QUuid _uid;
+    EntityId _entityId;
+
+    mutable QUuid _uid;
 
    private:
     Node *_outNode = nullptr;
@@ -2,6 +2,8 @@
 
 #include <QtCore/QPointF>
 #include <QtCore/QRectF>
+#include <QtGui/QPainterPath>
+#include <QtGui/QPolygonF>
 #include <iostream>
 
 #include "PortType.hpp"
@@ -19,8 +21,21 @@ class ConnectionGeometry {
 
     void moveEndPoint(PortType portType, QPointF const &offset);
 
+    /// 结果缓存起来, 端点变化后才重新计算
     QRectF boundingRect() const;
 
+    /// 从 source 到 sink 的三次曲线, 与 boundingRect() 一样缓存
+    QPainterPath const &cubicPath() const;
+
+    /// 把 cubicPath() 按长度等分成 PolylineSegments 段的折线,
+    /// 共 PolylineSegments + 1 个点, 与 cubicPath() 一样缓存
+    QPolygonF const &polyline() const;
+
+    static constexpr int PolylineSegments = 60;
+
+    /// 点击和悬停检测用的曲线轮廓. 描边比较费时, 所以也缓存起来
+    QPainterPath const &hitShape() const;
+
     std::pair<QPointF, QPointF> pointsC1C2() const;
 
     QPointF source() const { return _out; }
@@ -33,6 +48,10 @@ class ConnectionGeometry {
 
     void setHovered(bool hovered) { _hovered = hovered; }
 
+   private:
+    /// 端点变化后清除缓存
+    void invalidate();
+
    private:
     // local object coordinates
     QPointF _in;
@@ -43,5 +62,15 @@ class ConnectionGeometry {
     double _lineWidth;
 
     bool _hovered;
+
+    mutable QRectF _boundingRect;
+    mutable QPainterPath _cubicPath;
+    mutable QPainterPath _hitShape;
+    mutable QPolygonF _polyline;
+
+    mutable bool _boundingRectValid = false;
+    mutable bool _cubicPathValid = false;
+    mutable bool _hitShapeValid = false;
+    mutable bool _polylineValid = false;
 };
 }  // namespace QtNodes
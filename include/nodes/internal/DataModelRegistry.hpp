@@ -1,10 +1,14 @@
 #pragma once
 
+#include <QtCore/QJsonObject>
 #include <QtCore/QString>
+#include <any>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <set>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "Export.hpp"
@@ -30,8 +34,24 @@ class NODE_EDITOR_PUBLIC DataModelRegistry {
     using RegisteredModelsCategoryMap = std::unordered_map<QString, QString>;
     using CategoriesSet = std::set<QString>;
 
+    /// Turns a saved model payload into an intermediate value that is later
+    /// handed to NodeDataModel::restore(). Called on worker threads while a
+    /// scene loads, so it must not touch anything but its argument.
+    using PayloadParser = std::function<std::any(QJsonObject const &)>;
+
+    /// Small integer interned for every NodeDataType::id used by a type
+    /// converter, and for the port types of models that registerModel() has
+    /// to build to learn their name. Models with a static `Name()` are not
+    /// built at registration, so types that only appear on their ports stay
+    /// uninterned and are compared by name, which gives the same answers
+    /// since only interned types can have converters. 0 is never assigned.
+    using TypeId = std::uint32_t;
+
+    static constexpr TypeId InvalidTypeId = 0;
+
+    /// Keyed by (input type id << 32 | output type id)
     using RegisteredTypeConvertersMap =
-        std::map<TypeConverterId, TypeConverter>;
+        std::unordered_map<std::uint64_t, TypeConverter>;
 
     DataModelRegistry() = default;
 
@@ -66,9 +86,15 @@ class NODE_EDITOR_PUBLIC DataModelRegistry {
     }
 
     void registerTypeConverter(TypeConverterId const &id,
-                               TypeConverter typeConverter) {
-        _registeredTypeConverters[id] = std::move(typeConverter);
-    }
+                               TypeConverter typeConverter);
+
+    /// Models with a `static std::any ParsePayload(QJsonObject const &)`
+    /// get their parser registered by registerModel() already.
+    void registerPayloadParser(QString const &modelName,
+                               PayloadParser parser);
+
+    /// Returns nullptr when the model has no payload parser.
+    PayloadParser const *payloadParser(QString const &modelName) const;
 
     std::unique_ptr<NodeDataModel> create(QString const &modelName);
 
@@ -82,6 +108,28 @@ class NODE_EDITOR_PUBLIC DataModelRegistry {
     TypeConverter getTypeConverter(NodeDataType const &d1,
                                    NodeDataType const &d2) const;
 
+    /// Interned id of the type, InvalidTypeId if the type was never
+    /// registered with a model or a converter.
+    TypeId typeId(NodeDataType const &type) const;
+
+    /// Returns nullptr when there is no converter from d1 to d2.
+    TypeConverter const *findTypeConverter(TypeId d1, TypeId d2) const;
+
+    /// Whether data of type d1 can be connected to a port of type d2, either
+    /// directly or through a registered converter.
+    bool canConvert(NodeDataType const &d1, NodeDataType const &d2) const;
+
+    bool canConvert(TypeId d1, TypeId d2) const;
+
+    /// Number of interned types. Types are never removed, so a change means
+    /// that new ids were assigned.
+    std::size_t typeCount() const;
+
+   private:
+    TypeId internType(QString const &id);
+
+    void internPortTypes(NodeDataModel const &model);
+
    private:
     RegisteredModelsCategoryMap _registeredModelsCategory;
 
@@ -91,6 +139,10 @@ class NODE_EDITOR_PUBLIC DataModelRegistry {
 
     RegisteredTypeConvertersMap _registeredTypeConverters;
 
+    std::unordered_map<QString, TypeId> _typeIds;
+
+    std::unordered_map<QString, PayloadParser> _payloadParsers;
+
    private:
     // If the registered ModelType class has the static member method
     //
@@ -109,25 +161,56 @@ class NODE_EDITOR_PUBLIC DataModelRegistry {
                std::is_same<decltype(T::Name()), QString>::value>::type>
         : std::true_type {};
 
+    // The model may also have the static member method
+    //
+    //      static std::any ParsePayload(QJsonObject const &);
+    //
+    // which is then registered as its payload parser.
+
+    template <typename T, typename = void>
+    struct HasStaticMethodParsePayload : std::false_type {};
+
+    template <typename T>
+    struct HasStaticMethodParsePayload<
+        T, typename std::enable_if<std::is_same<
+               decltype(T::ParsePayload(std::declval<QJsonObject const &>())),
+               std::any>::value>::type> : std::true_type {};
+
+    template <typename ModelType>
+    typename std::enable_if<HasStaticMethodParsePayload<ModelType>::value>::type
+    registerPayloadParserOf(QString const &name) {
+        _payloadParsers[name] = &ModelType::ParsePayload;
+    }
+
+    template <typename ModelType>
+    typename std::enable_if<
+        !HasStaticMethodParsePayload<ModelType>::value>::type
+    registerPayloadParserOf(QString const &) {}
+
     template <typename ModelType>
     typename std::enable_if<HasStaticMethodName<ModelType>::value>::type
     registerModelImpl(RegistryItemCreator creator, QString const &category) {
         const QString name = ModelType::Name();
+        // 不为了登记端口类型而构造模型, 模型的构造函数可能很重
         if (_registeredItemCreators.count(name) == 0) {
             _registeredItemCreators[name] = std::move(creator);
             _categories.insert(category);
             _registeredModelsCategory[name] = category;
+            registerPayloadParserOf<ModelType>(name);
         }
     }
 
     template <typename ModelType>
     typename std::enable_if<!HasStaticMethodName<ModelType>::value>::type
     registerModelImpl(RegistryItemCreator creator, QString const &category) {
-        const QString name = creator()->name();
+        auto model = creator();
+        const QString name = model->name();
         if (_registeredItemCreators.count(name) == 0) {
+            internPortTypes(*model);
             _registeredItemCreators[name] = std::move(creator);
             _categories.insert(category);
             _registeredModelsCategory[name] = category;
+            registerPayloadParserOf<ModelType>(name);
         }
     }
 };
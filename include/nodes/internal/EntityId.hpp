@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QtCore/QtGlobal>
+
+#include "Export.hpp"
+
+namespace QtNodes {
+
+/// 节点和连接在运行时的标识: 进程内递增且唯一, 不会被保存.
+/// 需要持久标识时使用 Node::id()/Connection::id(), 它们在第一次被请求时才生成
+using EntityId = quint64;
+
+NODE_EDITOR_PUBLIC EntityId nextEntityId();
+}  // namespace QtNodes
@@ -5,10 +5,15 @@
 #include <functional>
 #include <tuple>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 #include "DataModelRegistry.hpp"
+#include "EntityId.hpp"
 #include "Export.hpp"
+#include "NodeProfile.hpp"
 #include "QUuidStdHash.hpp"
+#include "SlotMap.hpp"
 #include "TypeConverter.hpp"
 #include "memory.hpp"
 
@@ -26,11 +31,46 @@ class Connection;
 
 class ConnectionGraphicsObject;
 
+class ChangeJournal;
+
+class DataFlowScheduler;
+
+class NodeProfiler;
+
 class NodeStyle;
 
+class ParallelExecutor;
+
+class SceneLoader;
+
+struct SceneConnectionRecord;
+
+struct SceneData;
+
+struct SceneNodeRecord;
+
+class SpatialIndex;
+
+class TopologicalOrder;
+
 /// Scene holds connections and nodes.
+///
+/// A headless scene keeps the graph (nodes, connections, data propagation and
+/// serialization) but never allocates graphics items, so it can evaluate and
+/// save `.flow` graphs without paying for geometry updates or repaints.
 class NODE_EDITOR_PUBLIC FlowScene : public QGraphicsScene {
     Q_OBJECT
+
+    // 分批还原节点和连接, 以及写快照时使用场景的内部接口
+    friend class ChangeJournal;
+
+    friend class SceneLoader;
+
+    // 图元移动或改变大小后更新空间索引
+    friend class NodeGraphicsObject;
+
+    friend class ConnectionGraphicsObject;
+
    public:
     FlowScene(std::shared_ptr<DataModelRegistry> registry,
               QObject *parent = Q_NULLPTR);
@@ -39,16 +79,32 @@ class NODE_EDITOR_PUBLIC FlowScene : public QGraphicsScene {
 
     ~FlowScene();
 
+    /// Immediate pushes every updated value down the graph synchronously.
+    /// Deferred only marks the downstream nodes dirty and propagates them
+    /// once, in dependent order, on the next event loop tick or flush().
+    enum class PropagationMode { Immediate, Deferred };
+
+    /// Formats of a saved scene. Json is the readable `.flow` format; Binary
+    /// keeps names in a string table, refers to nodes by index and stores
+    /// model payloads as length-prefixed blobs. Loading detects the format.
+    enum class SceneFormat { Json, Binary };
+
    public:
     std::shared_ptr<Connection> createConnection(PortType connectedPort,
                                                  Node &node,
                                                  PortIndex portIndex);
 
+    /// Returns nullptr when the connection would close a cycle.
     std::shared_ptr<Connection> createConnection(
         Node &nodeIn, PortIndex portIndexIn, Node &nodeOut,
         PortIndex portIndexOut,
         TypeConverter const &converter = TypeConverter{});
 
+    /// Restores a single connection from its JSON. Parses both node ids and
+    /// looks the converter up in the registry on every call; scene loading
+    /// no longer uses it. Load whole scenes with loadFromMemory() or
+    /// SceneLoader, or call createConnection() directly.
+    [[deprecated("use loadFromMemory(), SceneLoader or createConnection()")]]
     std::shared_ptr<Connection> restoreConnection(
         QJsonObject const &connectionJson);
 
@@ -60,6 +116,11 @@ class NODE_EDITOR_PUBLIC FlowScene : public QGraphicsScene {
 
     void removeNode(Node &node);
 
+    /// Removes all the given nodes with their connections at once. Nothing
+    /// is propagated inside the removed set; only the surviving nodes that
+    /// lose an input receive empty data, in a single pass.
+    void removeNodes(std::vector<Node *> const &nodes);
+
     DataModelRegistry &registry() const;
 
     void setRegistry(std::shared_ptr<DataModelRegistry> registry);
@@ -72,33 +133,128 @@ class NODE_EDITOR_PUBLIC FlowScene : public QGraphicsScene {
     void iterateOverNodeDataDependentOrder(
         std::function<void(NodeDataModel *)> const &visitor);
 
+    /// Whether connecting an output of nodeOut to an input of nodeIn would
+    /// close a cycle. O(1) unless nodeIn currently precedes nodeOut in the
+    /// dependent order; then only the nodes in between are searched.
+    bool wouldCreateCycle(Node const &nodeOut, Node const &nodeIn) const;
+
     QPointF getNodePosition(Node const &node) const;
 
     void setNodePosition(Node &node, QPointF const &pos) const;
 
     QSizeF getNodeSize(Node const &node) const;
 
+    /// Nodes and connections created while the scene is headless get no
+    /// graphics objects. Switch the mode only while the scene is empty.
+    void setHeadless(bool headless);
+
+    bool isHeadless() const;
+
+    void setPropagationMode(PropagationMode mode);
+
+    PropagationMode propagationMode() const;
+
+    /// Propagates all pending updates of the deferred mode right now.
+    /// Does nothing inside a batch.
+    void flush();
+
+    /// Starts building the graph in bulk. Until the matching commitBatch(),
+    /// created nodes and connections emit no per-item signals, data is not
+    /// propagated and the views do not repaint. Batches nest; only the
+    /// outermost commit takes effect.
+    void beginBatch();
+
+    /// Notifies the models of the new connections, propagates all pending
+    /// data in one pass in dependent order and emits batchCommitted().
+    void commitBatch();
+
+    bool inBatch() const;
+
+    /// Evaluates the whole graph once, running independent nodes
+    /// concurrently on a work-stealing thread pool. Models that are not
+    /// NodeDataModel::threadSafe() are computed on the calling thread.
+    /// Blocks until every node has been computed, then refreshes the nodes.
+    /// A threadCount of 0 uses all hardware threads.
+    ///
+    /// Meant for headless scenes and batch evaluation (tools, tests, exports):
+    /// called from the GUI thread it freezes the editor for as long as the
+    /// whole graph takes, and the graph must not change while it runs. In an
+    /// interactive editor let slow models compute through
+    /// NodeDataModel::computeAsync() instead.
+    void executeParallel(unsigned int threadCount = 0);
+
+    /// Number of nodes whose model has an asynchronous computation in flight.
+    std::size_t computingNodeCount() const;
+
+    /// Collects per-node compute statistics (see NodeProfile). Off by
+    /// default; while off the instrumentation is a single null check.
+    void setProfilingEnabled(bool enabled);
+
+    bool isProfilingEnabled() const;
+
+    NodeProfile const &nodeProfile(Node const &node) const;
+
+    /// Zeroes the statistics of every node.
+    void resetProfiles();
+
+    /// Up to count nodes with the largest cumulative compute time, hottest
+    /// first.
+    std::vector<Node *> hottestNodes(std::size_t count) const;
+
+    /// Largest cumulative compute time of a single node, in nanoseconds.
+    qint64 hottestComputeTime() const;
+
+    /// Tints every node by its compute time relative to the hottest node.
+    /// Only drawn while profiling is enabled.
+    void setProfileOverlayVisible(bool visible);
+
+    bool isProfileOverlayVisible() const;
+
    public:
-    std::unordered_map<QUuid, std::unique_ptr<Node> > const &nodes() const;
+    /// Nodes live in place in paged slot storage; iterating visits every
+    /// node without a hash-table walk.
+    using NodeStorage = SlotMap<Node>;
+
+    using ConnectionStorage = SlotMap<std::shared_ptr<Connection> >;
 
-    std::unordered_map<QUuid, std::shared_ptr<Connection> > const &connections()
-        const;
+    NodeStorage const &nodes() const;
+
+    ConnectionStorage const &connections() const;
+
+    /// nullptr if there is no node with this id. Nodes only get a QUuid when
+    /// one is asked for, so this does not create any.
+    Node *nodeById(QUuid const &id) const;
 
     std::vector<Node *> allNodes() const;
 
     std::vector<Node *> selectedNodes() const;
 
+    /// Node and connection graphics items whose scene bounding rect
+    /// intersects `area`, in no particular order. Answered from a uniform
+    /// grid kept up to date as items move, so it does not scan the scene.
+    std::vector<QGraphicsItem *> indexedItems(QRectF const &area) const;
+
+    /// Node and connection graphics items whose scene bounding rect
+    /// contains `scenePoint`.
+    std::vector<QGraphicsItem *> indexedItems(QPointF const &scenePoint) const;
+
    public:
     void clearScene();
 
+    /// Saves binary when the file name ends with `.flowb`.
     void save() const;
 
     void load();
 
-    QByteArray saveToMemory() const;
+    QByteArray saveToMemory(SceneFormat format = SceneFormat::Json) const;
 
     void loadFromMemory(const QByteArray &data);
 
+    /// Converts saved scene data to the given format without building a
+    /// scene. Returns an empty array if the data cannot be read.
+    static QByteArray convertScene(QByteArray const &data,
+                                   SceneFormat format);
+
    Q_SIGNALS:
 
     /**
@@ -134,18 +290,80 @@ class NODE_EDITOR_PUBLIC FlowScene : public QGraphicsScene {
 
     void nodeContextMenu(Node &n, const QPointF &pos);
 
-   private:
-    using SharedConnection = std::shared_ptr<Connection>;
-    using UniqueNode = std::unique_ptr<Node>;
+    /// Emitted once per committed batch instead of nodeCreated() and
+    /// connectionCreated() for every item. Items created and deleted within
+    /// the same batch are not listed.
+    void batchCommitted(std::vector<QtNodes::Node *> const &nodes,
+                        std::vector<QtNodes::Connection *> const &connections);
+
+    /// The model of the node started an asynchronous computation.
+    void nodeComputingStarted(Node &n);
 
-    std::unordered_map<QUuid, SharedConnection> _connections;
-    std::unordered_map<QUuid, UniqueNode> _nodes;
+    /// All asynchronous computations of the node's model have landed.
+    void nodeComputingFinished(Node &n);
+
+   private:
+    // 节点和连接的图元析构时从索引中移除, 所以索引要最后析构
+    std::unique_ptr<SpatialIndex> _spatialIndex;
+    NodeStorage _nodes;
+    ConnectionStorage _connections;
+    // QUuids are only needed to resolve saved connections; nodes report
+    // their QUuid when it is created or restored, so a miss is a plain miss
+    std::unordered_map<QUuid, SlotHandle> _nodeIndex;
+    std::unordered_map<EntityId, SlotHandle> _connectionIndex;
     std::shared_ptr<DataModelRegistry> _registry;
+    bool _headless = false;
+    std::unique_ptr<TopologicalOrder> _topologicalOrder;
+    std::unique_ptr<DataFlowScheduler> _scheduler;
+    std::unique_ptr<ParallelExecutor> _executor;
+    std::size_t _computingNodeCount = 0;
+    std::unique_ptr<NodeProfiler> _profiler;
+    bool _profileOverlayVisible = false;
+    unsigned int _batchDepth = 0;
+    // 批处理中创建的节点和连接. 在同一批中删除的只记进 _batchRemoved,
+    // commitBatch() 时再过滤掉, 指针可能已经失效, 所以按 EntityId 过滤
+    std::vector<std::pair<Node *, EntityId> > _batchNodes;
+    std::vector<std::pair<Connection *, EntityId> > _batchConnections;
+    std::unordered_set<EntityId> _batchRemoved;
+    // load() 使用的加载器, 场景的子对象, 第一次加载时创建
+    SceneLoader *_loader = nullptr;
+
+   private:
+    Node &makeNode(std::unique_ptr<NodeDataModel> &&dataModel);
+
+    void addConnection(std::shared_ptr<Connection> const &connection);
+
+    /// 节点的连接都已删除后, 把节点从场景中移除
+    void eraseNode(Node &node);
+
+    Node &restoreNode(SceneNodeRecord const &record);
+
+    void restoreScene(SceneData const &scene);
+
+    /// 文件中的端口下标是否在两端节点的端口数之内.
+    /// 损坏或者手工修改过的文件中可能超出, 这样的连接和引用了不存在的节点的
+    /// 连接一样跳过
+    static bool portsInRange(SceneConnectionRecord const &record,
+                             Node const &nodeIn, Node const &nodeOut);
+
+    /// count 个连接因为引用了不存在的节点或端口被跳过
+    static void reportDanglingConnections(std::size_t count);
+
+    SceneData sceneData() const;
+
+    void setNodeComputing(Node &node, bool computing);
+
+    /// 按图元当前在场景中的包围盒登记或更新
+    void indexItem(QGraphicsItem &item);
+
+    void unindexItem(QGraphicsItem &item);
 
    private Q_SLOTS:
 
     void setupConnectionSignals(Connection const &c) const;
 
+    void updateTopologicalOrder(Connection const &c);
+
     static void sendConnectionCreatedToNodes(Connection const &c);
 
     static void sendConnectionDeletedToNodes(Connection const &c);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QtWidgets/QGraphicsView>
+#include <QtWidgets/QRubberBand>
 
 #include "Export.hpp"
 
@@ -46,6 +47,8 @@ class NODE_EDITOR_PUBLIC FlowView : public QGraphicsView {
 
     void mouseMoveEvent(QMouseEvent *event) override;
 
+    void mouseReleaseEvent(QMouseEvent *event) override;
+
     void drawBackground(QPainter *painter, const QRectF &r) override;
 
     void showEvent(QShowEvent *event) override;
@@ -53,12 +56,22 @@ class NODE_EDITOR_PUBLIC FlowView : public QGraphicsView {
    protected:
     FlowScene *scene();
 
+   private:
+    /// 按住 Shift 拖出的选择框. 选择框内的图元从场景的空间索引中查找,
+    /// 不像 QGraphicsView::RubberBandDrag 那样每次移动都遍历整个场景
+    void updateRubberBandSelection(QPoint const &viewPos);
+
    private:
     QAction *_clearSelectionAction;
     QAction *_deleteSelectionAction;
 
     QPointF _clickPos;
 
+    QRubberBand *_rubberBand = nullptr;
+
+    /// 选择框起点, 视图坐标
+    QPoint _rubberBandOrigin;
+
     FlowScene *_scene;
 };
 }  // namespace QtNodes
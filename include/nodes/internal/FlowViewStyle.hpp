@@ -8,6 +8,15 @@
 namespace QtNodes {
 
 class NODE_EDITOR_PUBLIC FlowViewStyle : public Style {
+   public:
+    /// 缩小视图时节点和连接的绘制细节, 从多到少
+    enum class DetailLevel {
+        Full,    ///< 完整绘制
+        NoText,  ///< 不画文字
+        Flat,    ///< 节点只画一个纯色矩形
+        Dot,     ///< 节点只画一个点, 连接画成直线
+    };
+
    public:
     FlowViewStyle();
 
@@ -16,6 +25,9 @@ class NODE_EDITOR_PUBLIC FlowViewStyle : public Style {
    public:
     static void setStyle(QString jsonText);
 
+    /// scale 为视图的缩放比例, 即场景中的 1 个单位对应的像素数
+    DetailLevel detailLevel(double scale) const;
+
    private:
     void loadJsonText(QString jsonText) override;
 
@@ -27,5 +39,10 @@ class NODE_EDITOR_PUBLIC FlowViewStyle : public Style {
     QColor BackgroundColor;
     QColor FineGridColor;
     QColor CoarseGridColor;
+
+    /// 缩放比例低于这些值时进入对应的 DetailLevel
+    float NoTextDetailScale{};
+    float FlatDetailScale{};
+    float DotDetailScale{};
 };
 }  // namespace QtNodes
@@ -3,12 +3,19 @@
 #include <QtCore/QJsonObject>
 #include <QtCore/QObject>
 #include <QtCore/QUuid>
+#include <any>
+#include <functional>
+#include <optional>
+#include <vector>
 
 #include "ConnectionGraphicsObject.hpp"
+#include "DataModelRegistry.hpp"
+#include "EntityId.hpp"
 #include "Export.hpp"
 #include "NodeData.hpp"
 #include "NodeGeometry.hpp"
 #include "NodeGraphicsObject.hpp"
+#include "NodeProfile.hpp"
 #include "NodeState.hpp"
 #include "PortType.hpp"
 #include "Serializable.hpp"
@@ -20,10 +27,14 @@ class Connection;
 
 class ConnectionState;
 
+class DataFlowScheduler;
+
 class NodeGraphicsObject;
 
 class NodeDataModel;
 
+class NodeProfiler;
+
 class NODE_EDITOR_PUBLIC Node : public QObject, public Serializable {
     Q_OBJECT
 
@@ -38,15 +49,49 @@ class NODE_EDITOR_PUBLIC Node : public QObject, public Serializable {
 
     void unserialize(QJsonObject const &json) override;
 
+    /// 已经从文件中取出各个字段时使用, modelJson 和 payload 交给模型的
+    /// restore()
+    void unserialize(QUuid const &id, QPointF const &position,
+                     QJsonObject const &modelJson,
+                     std::any const &payload = std::any());
+
    public:
+    /// 持久标识, 第一次调用时才生成 (或者来自 unserialize()).
+    /// 生成时会修改节点并通知场景, 所以只能在 GUI 线程调用
     QUuid id() const;
 
+    /// 生成或者改变 id 时调用, oldId 为之前的 id (刚生成时为空)
+    using IdChangedCallback =
+        std::function<void(Node const &node, QUuid const &oldId)>;
+
+    /// 场景用它维护 id 到节点的索引
+    void setIdChangedCallback(IdChangedCallback callback);
+
+    /// id() 是否已经生成过
+    bool hasId() const;
+
+    /// 运行时标识, 创建节点时分配, 比较和哈希都只是整数操作
+    EntityId entityId() const { return _entityId; }
+
+    /// reactingNode 是正在拖动的连接另一端已经连上的节点,
+    /// reactingTypeId 是连接数据类型的 id, 为 InvalidTypeId 时只按名字比较
     void reactToPossibleConnection(PortType, NodeDataType const &,
-                                   QPointF const &scenePoint);
+                                   QPointF const &scenePoint,
+                                   Node const *reactingNode = nullptr,
+                                   DataModelRegistry::TypeId reactingTypeId =
+                                       DataModelRegistry::InvalidTypeId);
 
     void resetReactionToConnection();
 
+    /// 节点在scene中的位置. 没有图形对象(headless)时由节点自己保存
+    QPointF position() const;
+
+    void setPosition(QPointF const &pos);
+
    public:
+    /// headless 场景中的节点没有图形对象
+    bool hasGraphicsObject() const;
+
     const NodeGraphicsObject &nodeGraphicsObject() const;
 
     NodeGraphicsObject &nodeGraphicsObject();
@@ -63,6 +108,49 @@ class NODE_EDITOR_PUBLIC Node : public QObject, public Serializable {
 
     NodeDataModel *nodeDataModel() const;
 
+    /// 端口数据类型在 registry 中的 id, 见 DataModelRegistry::typeId().
+    /// 第一次查询时解析并缓存, 连接检查和绘制端口时只比较整数.
+    /// registry 登记了新的类型之后自动重新解析
+    DataModelRegistry::TypeId portTypeId(DataModelRegistry const &registry,
+                                         PortType portType,
+                                         PortIndex portIndex) const;
+
+    /// 模型的端口类型或者使用的 registry 可能变了, 下次查询时重新解析
+    void invalidatePortTypeIds() const;
+
+    /// 设置延迟传播所用的调度器, 为空时数据总是同步传播
+    void setScheduler(DataFlowScheduler *scheduler);
+
+    /// 立即把输出端口的数据传输到所有下游连接
+    void propagateData(PortIndex index) const;
+
+    /// 输入数据改变之后重新计算节点的几何尺寸并重绘
+    void updateGraphics() const;
+
+    /// 记录输入端口收到的数据, 返回它与上一次的数据是否不同.
+    /// 模型没有打开 NodeDataModel::memoizeInputs() 时总是返回 true
+    bool inputChanged(std::shared_ptr<NodeData> const &nodeData,
+                      PortIndex inPortIndex) const;
+
+    /// 输入记忆的命中/未命中次数
+    std::size_t memoHits() const { return _memoHits; }
+
+    std::size_t memoMisses() const { return _memoMisses; }
+
+    /// 清空记住的输入和计数, 下一次输入一定会重新计算
+    void resetMemo();
+
+    /// 设置性能分析器, 为空时不收集统计
+    void setProfiler(NodeProfiler *profiler);
+
+    NodeProfiler *profiler() const { return _profiler; }
+
+    NodeProfile const &profile() const { return _profile; }
+
+    NodeProfile &profile() { return _profile; }
+
+    void resetProfile();
+
    public Q_SLOTS:  // data propagation
 
     /// 将输入的数据传输到基础的数据模型
@@ -76,9 +164,13 @@ class NODE_EDITOR_PUBLIC Node : public QObject, public Serializable {
     void onNodeSizeUpdated();
 
    private:
-    // uuid
+    // identity
+
+    EntityId _entityId;
+
+    mutable QUuid _uid;
 
-    QUuid _uid;
+    IdChangedCallback _idChanged;
 
     // data
 
@@ -88,8 +180,47 @@ class NODE_EDITOR_PUBLIC Node : public QObject, public Serializable {
 
     // painting
 
+    /// 仅在没有图形对象时使用, 否则位置由图形对象保存
+    QPointF _position;
+
     NodeGeometry _nodeGeometry;
 
     std::unique_ptr<NodeGraphicsObject> _nodeGraphicsObject;
+
+    DataFlowScheduler *_scheduler = nullptr;
+
+    // port types
+
+    /// 解析时 registry 中登记的类型数, 见 DataModelRegistry::typeCount()
+    mutable std::size_t _portTypeCount = 0;
+
+    /// 每个端口的类型 id, 尚未解析的为空
+    mutable std::vector<std::optional<DataModelRegistry::TypeId>>
+        _inPortTypeIds;
+
+    mutable std::vector<std::optional<DataModelRegistry::TypeId>>
+        _outPortTypeIds;
+
+    // memoization
+
+    struct MemoizedInput {
+        std::optional<std::size_t> hash;
+
+        /// 哈希相同时用来确认值确实相同
+        std::shared_ptr<NodeData> data;
+    };
+
+    /// 每个输入端口上一次收到的数据
+    mutable std::vector<MemoizedInput> _inputs;
+
+    mutable std::size_t _memoHits = 0;
+
+    mutable std::size_t _memoMisses = 0;
+
+    // profiling
+
+    NodeProfiler *_profiler = nullptr;
+
+    mutable NodeProfile _profile;
 };
 }  // namespace QtNodes
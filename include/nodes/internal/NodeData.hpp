@@ -1,6 +1,8 @@
 #pragma once
 
 #include <QtCore/QString>
+#include <cstddef>
+#include <optional>
 
 #include "Export.hpp"
 
@@ -24,5 +26,21 @@ class NODE_EDITOR_PUBLIC NodeData {
 
     /// Type for inner use
     virtual NodeDataType type() const = 0;
+
+    /// Hash (or version) of the carried value, used by models that enable
+    /// NodeDataModel::memoizeInputs() as a quick check for a changed input.
+    /// Data without a hash is never memoized.
+    virtual std::optional<std::size_t> hash() const { return std::nullopt; }
+
+    /// Whether nodeData (of the same type) carries the same value. Confirms
+    /// a hash match before a memoized input is skipped; the default only
+    /// treats the very same instance as equal.
+    virtual bool equals(NodeData const &nodeData) const {
+        return this == &nodeData;
+    }
+
+    /// Approximate memory footprint of the carried value, reported by the
+    /// node profiler. 0 means unknown.
+    virtual std::size_t byteSize() const { return 0; }
 };
 }  // namespace QtNodes
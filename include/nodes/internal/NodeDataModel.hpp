@@ -1,6 +1,8 @@
 #pragma once
 
 #include <QtWidgets/QWidget>
+#include <any>
+#include <functional>
 
 #include "Export.hpp"
 #include "NodeData.hpp"
@@ -45,6 +47,14 @@ class NODE_EDITOR_PUBLIC NodeDataModel : public QObject, public Serializable {
    public:
     QJsonObject serialize() const override;
 
+    /// 加载场景时调用. payload 是注册的 PayloadParser 在工作线程中预先
+    /// 解析 modelJson 的结果 (见 DataModelRegistry::registerPayloadParser()),
+    /// 没有解析器时为空. 默认忽略它, 直接调用 unserialize()
+    virtual void restore(QJsonObject const &modelJson,
+                         std::any const & /*payload*/) {
+        unserialize(modelJson);
+    }
+
    public:
     virtual unsigned int nPorts(PortType portType) const = 0;
 
@@ -76,6 +86,16 @@ class NODE_EDITOR_PUBLIC NodeDataModel : public QObject, public Serializable {
 
     virtual bool resizable() const { return false; }
 
+    /// setInData()/outData() 可以在工作线程中调用 (不访问任何 widget).
+    /// 只有这样的模型才会被 FlowScene::executeParallel() 放进线程池计算
+    virtual bool threadSafe() const { return false; }
+
+    /// 输入记忆: 某个输入端口收到的数据与上一次相同 (NodeData::hash() 相同,
+    /// 并且 NodeData::equals()) 时不再调用 setInData(), 也就不会重新计算和
+    /// 向下游传输.
+    /// 只有输出完全由输入决定的模型才能打开
+    virtual bool memoizeInputs() const { return false; }
+
     virtual NodeValidationState validationState() const {
         return NodeValidationState::Valid;
     }
@@ -84,6 +104,19 @@ class NODE_EDITOR_PUBLIC NodeDataModel : public QObject, public Serializable {
 
     virtual NodePainterDelegate *painterDelegate() const { return nullptr; }
 
+   public:
+    /// 异步计算得到的结果, 在 GUI 线程中执行, 负责把结果保存为模型的输出
+    using AsyncResult = std::function<void()>;
+
+    /// 异步计算: work 在线程池中执行, 只能访问它自己捕获的数据.
+    /// work 返回的 AsyncResult 在 GUI 线程中执行, 之后所有输出端口会发出
+    /// dataUpdated. 计算开始和结束时分别发出 computingStarted 和
+    /// computingFinished. 新的计算开始后, 之前尚未完成的计算结果会被丢弃.
+    void computeAsync(std::function<AsyncResult()> work);
+
+    /// 是否有尚未完成的异步计算
+    bool computing() const { return _pendingComputations != 0; }
+
    public Q_SLOTS:
 
     virtual void inputConnectionCreated(Connection const &) {}
@@ -106,7 +139,18 @@ class NODE_EDITOR_PUBLIC NodeDataModel : public QObject, public Serializable {
 
     void embeddedWidgetSizeUpdated();
 
+    /// serialize() 的结果改变了, 但没有新的输出时发出 (例如没有输出端口的
+    /// 模型, 或在内嵌 widget 中的编辑). ChangeJournal 据此记录模型的变化
+    void stateChanged();
+
+   private:
+    void finishComputation(quint64 generation, AsyncResult const &result);
+
    private:
     NodeStyle _nodeStyle;
+
+    quint64 _computeGeneration = 0;
+
+    unsigned int _pendingComputations = 0;
 };
 }  // namespace QtNodes
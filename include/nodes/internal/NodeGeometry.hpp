@@ -2,8 +2,10 @@
 
 #include <QtCore/QPointF>
 #include <QtCore/QRectF>
+#include <QtGui/QFont>
 #include <QtGui/QFontMetrics>
 #include <QtGui/QTransform>
+#include <vector>
 
 #include "Export.hpp"
 #include "PortType.hpp"
@@ -18,6 +20,17 @@ class NodeDataModel;
 class Node;
 
 class NODE_EDITOR_PUBLIC NodeGeometry {
+   public:
+    /// 需要重新测量的内容. 文字的测量结果缓存起来, 只在对应的标志被设置后
+    /// 下一次 recalculateSize() 时重新测量
+    enum DirtyFlag : unsigned int {
+        DataDirty = 1 << 0,        ///< 标题和端口名可能变了
+        ValidationDirty = 1 << 1,  ///< 验证消息可能变了
+        FontDirty = 1 << 2,        ///< 所有文字都要重新测量
+        PortCountDirty = 1 << 3,   ///< 端口数变了
+        AllDirty = DataDirty | ValidationDirty | FontDirty | PortCountDirty,
+    };
+
    public:
     explicit NodeGeometry(std::unique_ptr<NodeDataModel> const &dataModel);
 
@@ -59,10 +72,17 @@ class NODE_EDITOR_PUBLIC NodeGeometry {
 
     QRectF boundingRect() const;
 
-    /// 无条件更新尺寸
+    /// 标记需要重新测量的内容, 下一次 recalculateSize() 时生效
+    void invalidate(unsigned int flags = AllDirty) const { _dirty |= flags; }
+
+    bool isDirty() const { return _dirty != 0; }
+
+    /// 重新测量被标记的内容, 再根据缓存的测量结果和 widget 大小更新尺寸.
+    /// 端口数的变化会自动检测到
     void recalculateSize() const;
 
-    /// 如果QFontMetrics大小改变, 更新窗口大小
+    /// 字体与上次测量时不同时重新测量所有文字, 否则不做任何事.
+    /// 每次绘制都会调用, 只比较字体
     void recalculateSize(QFont const &font) const;
 
     // TODO removed default QTransform()
@@ -80,9 +100,20 @@ class NODE_EDITOR_PUBLIC NodeGeometry {
     /// 返回不超过节点高度情况下widget的最大高度
     int equivalentWidgetHeight() const;
 
-    unsigned int validationHeight() const;
+    unsigned int validationHeight() const { return _validationHeight; }
+
+    unsigned int validationWidth() const { return _validationWidth; }
+
+    /// 验证消息用常规字体绘制时的宽度, 用来居中
+    unsigned int validationTextWidth() const { return _validationTextWidth; }
+
+    /// 标题的尺寸 (粗体), 标题不可见时为 0
+    unsigned int captionHeight() const { return _captionHeight; }
 
-    unsigned int validationWidth() const;
+    unsigned int captionWidth() const { return _captionWidth; }
+
+    /// 端口名的宽度, 与 NodePainter 画出的文字相同
+    unsigned int portLabelWidth(PortIndex index, PortType portType) const;
 
     static QPointF calculateNodePositionBetweenNodePorts(
         PortIndex targetPortIndex, PortType targetPort, Node *targetNode,
@@ -90,11 +121,11 @@ class NODE_EDITOR_PUBLIC NodeGeometry {
         Node &newNode);
 
    private:
-    unsigned int captionHeight() const;
-
-    unsigned int captionWidth() const;
+    /// 重新测量被标记的文字, 清除所有标志
+    void updateMeasurements() const;
 
-    unsigned int portWidth(PortType portType) const;
+    /// 测量每个端口名, 返回最大的宽度
+    unsigned int measurePorts(PortType portType) const;
 
    private:
     // some variables are mutable because
@@ -112,14 +143,29 @@ class NODE_EDITOR_PUBLIC NodeGeometry {
 
     bool _hovered;
 
-    unsigned int _nSources;
-    unsigned int _nSinks;
+    mutable unsigned int _nSources;
+    mutable unsigned int _nSinks;
 
     QPointF _draggingPos;
 
     std::unique_ptr<NodeDataModel> const &_dataModel;
 
+    mutable unsigned int _dirty = AllDirty;
+
+    /// 上次测量时使用的字体
+    mutable QFont _font;
+
     mutable QFontMetrics _fontMetrics;
     mutable QFontMetrics _boldFontMetrics;
+
+    mutable unsigned int _captionWidth = 0;
+    mutable unsigned int _captionHeight = 0;
+
+    mutable unsigned int _validationWidth = 0;
+    mutable unsigned int _validationHeight = 0;
+    mutable unsigned int _validationTextWidth = 0;
+
+    mutable std::vector<unsigned int> _inLabelWidths;
+    mutable std::vector<unsigned int> _outLabelWidths;
 };
 }  // namespace QtNodes
@@ -31,6 +31,9 @@ class NodeGraphicsObject : public QGraphicsObject {
 
     void setGeometryChanged();
 
+    /// 节点移动或改变大小之后更新场景的空间索引
+    void updateSpatialIndex();
+
     /// 访问所有连接的连接并更正其相应的端点。
     void moveConnections() const;
 
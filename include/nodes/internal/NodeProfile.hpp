@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QtCore/QtGlobal>
+
+namespace QtNodes {
+
+/// 节点的计算统计, 只有在 FlowScene::setProfilingEnabled() 打开时才会累计
+struct NodeProfile {
+    /// setInData() 被调用的次数
+    quint64 invocations = 0;
+
+    /// setInData() 花费的时间, 不包括其中同步触发的下游节点的计算
+    qint64 totalNanoseconds = 0;
+
+    qint64 maxNanoseconds = 0;
+
+    /// 输出数据的字节数之和 (见 NodeData::byteSize())
+    quint64 bytesProduced = 0;
+
+    /// 向下游连接传输数据的次数
+    quint64 transmissions = 0;
+};
+}  // namespace QtNodes
@@ -1,18 +1,21 @@
 #pragma once
 
 #include <QtCore/QUuid>
-#include <unordered_map>
 #include <vector>
 
+#include "DataModelRegistry.hpp"
 #include "Export.hpp"
 #include "NodeData.hpp"
 #include "PortType.hpp"
+#include "SmallVector.hpp"
 #include "memory.hpp"
 
 namespace QtNodes {
 
 class Connection;
 
+class Node;
+
 class NodeDataModel;
 
 /// Contains vectors of connected input and output connections.
@@ -25,20 +28,24 @@ class NODE_EDITOR_PUBLIC NodeState {
     NodeState(std::unique_ptr<NodeDataModel> const &model);
 
    public:
-    using ConnectionPtrSet = std::unordered_map<QUuid, Connection *>;
+    /// 一个端口上的连接. 绝大多数端口只有零或一个连接, 这时不分配内存
+    using ConnectionList = SmallVector<Connection *, 2>;
 
-    /// Returns vector of connections ID.
-    /// Some of them can be empty (null)
-    std::vector<ConnectionPtrSet> const &getEntries(PortType) const;
+    /// Returns the connections of every port.
+    /// Some of them can be empty
+    std::vector<ConnectionList> const &getEntries(PortType) const;
 
-    std::vector<ConnectionPtrSet> &getEntries(PortType);
+    std::vector<ConnectionList> &getEntries(PortType);
 
-    ConnectionPtrSet connections(PortType portType, PortIndex portIndex) const;
+    /// 返回引用, 遍历时不复制. 遍历过程中不要增删这个端口上的连接
+    ConnectionList const &connections(PortType portType,
+                                      PortIndex portIndex) const;
 
     void setConnection(PortType portType, PortIndex portIndex,
                        Connection &connection);
 
-    void eraseConnection(PortType portType, PortIndex portIndex, QUuid id);
+    void eraseConnection(PortType portType, PortIndex portIndex,
+                         Connection const &connection);
 
     ReactToConnectionState reaction() const;
 
@@ -46,10 +53,22 @@ class NODE_EDITOR_PUBLIC NodeState {
 
     NodeDataType reactingDataType() const;
 
-    void setReaction(ReactToConnectionState reaction,
-                     PortType reactingPortType = PortType::None,
+    /// reactingDataType() 在 registry 中的 id, 没有登记时为 InvalidTypeId
+    DataModelRegistry::TypeId reactingTypeId() const;
+
+    /// 正在拖动的连接另一端已经连上的节点
+    Node const *reactingNode() const;
+
+    void setReaction(
+        ReactToConnectionState reaction,
+        PortType reactingPortType = PortType::None,
+
+        NodeDataType reactingDataType = NodeDataType(),
 
-                     NodeDataType reactingDataType = NodeDataType());
+        Node const *reactingNode = nullptr,
+
+        DataModelRegistry::TypeId reactingTypeId =
+            DataModelRegistry::InvalidTypeId);
 
     bool isReacting() const;
 
@@ -57,14 +76,23 @@ class NODE_EDITOR_PUBLIC NodeState {
 
     bool resizing() const;
 
+    /// 模型正在异步计算
+    void setComputing(bool computing);
+
+    bool computing() const;
+
    private:
-    std::vector<ConnectionPtrSet> _inConnections;
-    std::vector<ConnectionPtrSet> _outConnections;
+    std::vector<ConnectionList> _inConnections;
+    std::vector<ConnectionList> _outConnections;
 
     ReactToConnectionState _reaction;
     PortType _reactingPortType;
     NodeDataType _reactingDataType;
+    DataModelRegistry::TypeId _reactingTypeId;
+    Node const *_reactingNode;
 
     bool _resizing;
+
+    bool _computing;
 };
 }  // namespace QtNodes
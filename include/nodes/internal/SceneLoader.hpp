@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QTimer>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Export.hpp"
+#include "SlotMap.hpp"
+
+namespace QtNodes {
+
+class FlowScene;
+
+struct SceneData;
+
+/// 不阻塞 GUI 的场景加载.
+/// 读文件和解析在工作线程中进行, 然后在 GUI 线程中分批创建节点和连接,
+/// 每批最多占用 sliceDuration() 毫秒, 所以加载期间界面仍然可以响应,
+/// 已经创建的部分也可以操作. 加载器是场景的子对象, 随场景一起销毁
+class NODE_EDITOR_PUBLIC SceneLoader : public QObject {
+    Q_OBJECT
+
+   public:
+    enum class Result { Completed, Canceled, Failed };
+    Q_ENUM(Result)
+
+    explicit SceneLoader(FlowScene &scene);
+
+    ~SceneLoader() override;
+
+   public:
+    /// 开始加载文件, 立即返回. 正在进行的加载会被取消
+    void load(QString const &fileName);
+
+    /// 同上, 数据可以是 JSON 或二进制格式
+    void loadFromMemory(QByteArray data);
+
+    /// 停止加载, 已经创建的节点和连接保留在场景中
+    void cancel();
+
+    bool isLoading() const;
+
+    int sliceDuration() const;
+
+    void setSliceDuration(int milliseconds);
+
+    /// 加载失败时的原因
+    QString errorString() const;
+
+   Q_SIGNALS:
+    /// 解析完成, 开始创建节点
+    void parsed(std::size_t nodeCount, std::size_t connectionCount);
+
+    /// 每批创建完成后发出, total 是节点数和连接数之和
+    void progress(std::size_t done, std::size_t total);
+
+    void finished(QtNodes::SceneLoader::Result result);
+
+   private:
+    void start(std::function<QByteArray(QString &error)> read);
+
+    void finishParsing(quint64 generation, std::shared_ptr<SceneData> data,
+                       QString const &error);
+
+    void restoreSlice();
+
+    void finish(Result result);
+
+   private:
+    FlowScene &_scene;
+
+    QTimer _timer;
+
+    int _sliceDuration = 15;
+
+    /// 每次开始或取消加载时递增, 用来丢弃过期的解析结果
+    quint64 _generation = 0;
+
+    bool _loading = false;
+
+    QString _errorString;
+
+    std::shared_ptr<SceneData> _data;
+
+    /// 已经创建的节点. 加载期间节点可能被删除, 所以保存句柄
+    std::vector<SlotHandle> _nodes;
+
+    std::size_t _nextConnection = 0;
+
+    /// 引用了不存在的节点或端口而被跳过的连接数
+    std::size_t _danglingConnections = 0;
+};
+}  // namespace QtNodes
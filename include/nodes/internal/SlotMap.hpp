@@ -0,0 +1,235 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace QtNodes {
+
+/// Generational handle into a SlotMap. Once the object it refers to is
+/// erased the handle stops resolving, even if the slot is reused.
+struct SlotHandle {
+    static constexpr std::uint32_t InvalidIndex = ~std::uint32_t(0);
+
+    std::uint32_t index = InvalidIndex;
+    std::uint32_t generation = 0;
+
+    bool isValid() const { return index != InvalidIndex; }
+
+    friend bool operator==(SlotHandle const &a, SlotHandle const &b) {
+        return a.index == b.index && a.generation == b.generation;
+    }
+
+    friend bool operator!=(SlotHandle const &a, SlotHandle const &b) {
+        return !(a == b);
+    }
+};
+
+/// Stores objects in place in fixed-size pages, so their addresses never
+/// change and a freed slot is reused by the next insertion instead of going
+/// back to the allocator. The indices of the live slots are kept in a dense
+/// array that iteration walks in order.
+template <typename T, std::size_t PageSize = 256>
+class SlotMap {
+    struct Slot {
+        // Must stay the first member: handleOf() maps an object's address
+        // back to its slot.
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        std::uint32_t index = 0;
+        std::uint32_t generation = 0;
+        std::uint32_t denseIndex = 0;
+        bool alive = false;
+
+        T &value() { return *std::launder(reinterpret_cast<T *>(storage)); }
+
+        T const &value() const {
+            return *std::launder(reinterpret_cast<T const *>(storage));
+        }
+    };
+
+   public:
+    template <bool Const>
+    class Iterator {
+        using Map = typename std::conditional<Const, SlotMap const,
+                                              SlotMap>::type;
+
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using reference =
+            typename std::conditional<Const, T const &, T &>::type;
+        using pointer =
+            typename std::conditional<Const, T const *, T *>::type;
+
+        Iterator(Map *map, std::size_t position)
+            : _map(map), _position(position) {}
+
+        reference operator*() const {
+            return _map->slotAt(_map->_dense[_position]).value();
+        }
+
+        pointer operator->() const { return &**this; }
+
+        Iterator &operator++() {
+            ++_position;
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++_position;
+            return old;
+        }
+
+        bool operator==(Iterator const &other) const {
+            return _position == other._position;
+        }
+
+        bool operator!=(Iterator const &other) const {
+            return _position != other._position;
+        }
+
+       private:
+        Map *_map;
+        std::size_t _position;
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    SlotMap() = default;
+
+    SlotMap(SlotMap const &) = delete;
+
+    SlotMap &operator=(SlotMap const &) = delete;
+
+    ~SlotMap() { clear(); }
+
+    template <typename... Args>
+    SlotHandle emplace(Args &&...args) {
+        std::uint32_t index;
+
+        if (!_freeList.empty()) {
+            index = _freeList.back();
+            _freeList.pop_back();
+        } else {
+            index = _capacity++;
+
+            if (index % PageSize == 0)
+                _pages.push_back(std::make_unique<Slot[]>(PageSize));
+        }
+
+        Slot &slot = slotAt(index);
+
+        try {
+            ::new (static_cast<void *>(slot.storage))
+                T(std::forward<Args>(args)...);
+        } catch (...) {
+            _freeList.push_back(index);
+            throw;
+        }
+
+        slot.index = index;
+        slot.alive = true;
+        slot.denseIndex = static_cast<std::uint32_t>(_dense.size());
+
+        _dense.push_back(index);
+
+        return SlotHandle{index, slot.generation};
+    }
+
+    /// Returns nullptr for a stale or invalid handle.
+    T *get(SlotHandle handle) {
+        Slot *slot = find(handle);
+        return slot ? &slot->value() : nullptr;
+    }
+
+    T const *get(SlotHandle handle) const {
+        Slot const *slot = const_cast<SlotMap *>(this)->find(handle);
+        return slot ? &slot->value() : nullptr;
+    }
+
+    /// Handle of an object that lives in this map.
+    SlotHandle handleOf(T const &value) const {
+        auto slot = reinterpret_cast<Slot const *>(&value);
+        return SlotHandle{slot->index, slot->generation};
+    }
+
+    /// The object is destroyed after it has been unlinked, so its destructor
+    /// may safely look at (or insert into) the map.
+    bool erase(SlotHandle handle) {
+        Slot *slot = find(handle);
+
+        if (!slot) return false;
+
+        std::uint32_t const last = _dense.back();
+        _dense[slot->denseIndex] = last;
+        slotAt(last).denseIndex = slot->denseIndex;
+        _dense.pop_back();
+
+        slot->alive = false;
+        ++slot->generation;
+
+        slot->value().~T();
+
+        _freeList.push_back(handle.index);
+
+        return true;
+    }
+
+    void clear() {
+        while (!_dense.empty()) {
+            Slot &slot = slotAt(_dense.back());
+            erase(SlotHandle{slot.index, slot.generation});
+        }
+    }
+
+    std::size_t size() const { return _dense.size(); }
+
+    bool empty() const { return _dense.empty(); }
+
+    iterator begin() { return iterator(this, 0); }
+
+    iterator end() { return iterator(this, _dense.size()); }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+
+    const_iterator end() const { return const_iterator(this, _dense.size()); }
+
+   private:
+    Slot &slotAt(std::uint32_t index) {
+        return _pages[index / PageSize][index % PageSize];
+    }
+
+    Slot const &slotAt(std::uint32_t index) const {
+        return _pages[index / PageSize][index % PageSize];
+    }
+
+    Slot *find(SlotHandle handle) {
+        if (handle.index >= _capacity) return nullptr;
+
+        Slot &slot = slotAt(handle.index);
+
+        if (!slot.alive || slot.generation != handle.generation) return nullptr;
+
+        return &slot;
+    }
+
+   private:
+    std::vector<std::unique_ptr<Slot[]>> _pages;
+
+    /// Indices of the live slots, in iteration order
+    std::vector<std::uint32_t> _dense;
+
+    std::vector<std::uint32_t> _freeList;
+
+    std::uint32_t _capacity = 0;
+};
+}  // namespace QtNodes
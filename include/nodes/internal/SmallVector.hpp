@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace QtNodes {
+
+/// Vector of trivially copyable values that keeps up to N of them inline and
+/// only touches the heap once it outgrows that. Meant for short per-port
+/// lists, most of which hold zero or one element.
+template <typename T, std::size_t N>
+class SmallVector {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SmallVector only holds trivially copyable values");
+
+   public:
+    using value_type = T;
+    using iterator = T *;
+    using const_iterator = T const *;
+
+    SmallVector() = default;
+
+    SmallVector(SmallVector const &other) { *this = other; }
+
+    SmallVector &operator=(SmallVector const &other) {
+        if (this != &other) {
+            clear();
+            reserve(other._size);
+            std::copy(other.begin(), other.end(), data());
+            _size = other._size;
+        }
+
+        return *this;
+    }
+
+    iterator begin() { return data(); }
+
+    iterator end() { return data() + _size; }
+
+    const_iterator begin() const { return data(); }
+
+    const_iterator end() const { return data() + _size; }
+
+    std::size_t size() const { return _size; }
+
+    bool empty() const { return _size == 0; }
+
+    T &operator[](std::size_t i) { return data()[i]; }
+
+    T const &operator[](std::size_t i) const { return data()[i]; }
+
+    T &front() { return data()[0]; }
+
+    T const &front() const { return data()[0]; }
+
+    T &back() { return data()[_size - 1]; }
+
+    T const &back() const { return data()[_size - 1]; }
+
+    void push_back(T const &value) {
+        if (_size == _capacity) reserve(_capacity * 2);
+
+        data()[_size++] = value;
+    }
+
+    /// Removes the first element equal to value, keeping the order of the
+    /// others. Returns whether anything was removed.
+    bool remove(T const &value) {
+        iterator it = std::find(begin(), end(), value);
+
+        if (it == end()) return false;
+
+        std::copy(it + 1, end(), it);
+        --_size;
+
+        return true;
+    }
+
+    /// Keeps the heap buffer, if any, for the next insertions.
+    void clear() { _size = 0; }
+
+    void reserve(std::size_t capacity) {
+        if (capacity <= _capacity) return;
+
+        auto heap = std::make_unique<T[]>(capacity);
+        std::copy(begin(), end(), heap.get());
+
+        _heap = std::move(heap);
+        _capacity = capacity;
+    }
+
+   private:
+    T *data() { return _heap ? _heap.get() : _inline; }
+
+    T const *data() const { return _heap ? _heap.get() : _inline; }
+
+   private:
+    T _inline[N] = {};
+
+    std::unique_ptr<T[]> _heap;
+
+    std::size_t _size = 0;
+
+    std::size_t _capacity = N;
+};
+}  // namespace QtNodes
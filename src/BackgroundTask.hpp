@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QMetaObject>
+#include <QtCore/QPointer>
+#include <QtCore/QThreadPool>
+#include <utility>
+
+namespace QtNodes {
+
+/// 在全局线程池中执行 work(), 再回到 GUI 线程调用 done(*receiver, 结果).
+///
+/// receiver 可能在 work() 执行期间被删除. 工作线程不能访问它, 也不能把它
+/// 作为 invokeMethod 的上下文 (删除和投递可能同时发生), 所以结果通过
+/// application 对象送回 GUI 线程, 在那里用 QPointer 确认 receiver 还在之后
+/// 才调用 done. receiver 已经被删除时结果被丢弃
+template <typename Receiver, typename Work, typename Done>
+void runInBackground(Receiver *receiver, Work work, Done done) {
+    QPointer<Receiver> self(receiver);
+
+    QThreadPool::globalInstance()->start(
+        [self, work = std::move(work), done = std::move(done)]() {
+            auto result = work();
+
+            QMetaObject::invokeMethod(
+                QCoreApplication::instance(),
+                [self, done, result = std::move(result)]() {
+                    if (self) done(*self, result);
+                },
+                Qt::QueuedConnection);
+        });
+}
+}  // namespace QtNodes
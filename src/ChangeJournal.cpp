@@ -0,0 +1,593 @@
+#include "ChangeJournal.hpp"
+
+#include <QtCore/QHash>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QJsonParseError>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStringList>
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "BackgroundTask.hpp"
+#include "Connection.hpp"
+#include "DataModelRegistry.hpp"
+#include "FlowScene.hpp"
+#include "Node.hpp"
+#include "NodeDataModel.hpp"
+#include "SceneData.hpp"
+
+using QtNodes::ChangeJournal;
+using QtNodes::Connection;
+using QtNodes::FlowScene;
+using QtNodes::Node;
+using QtNodes::NodeDataModel;
+using QtNodes::PortIndex;
+using QtNodes::SceneConnectionRecord;
+using QtNodes::SceneConverterTable;
+using QtNodes::SceneData;
+using QtNodes::SceneNodeRecord;
+using QtNodes::runInBackground;
+
+namespace {
+
+QString journalName(QString const &fileName) {
+    return fileName + QStringLiteral(".journal");
+}
+
+/// 正在合并进快照的那段日志
+QString compactingJournalName(QString const &fileName) {
+    return fileName + QStringLiteral(".journal.old");
+}
+
+QByteArray entry(QString const &op, QJsonObject body) {
+    body["op"] = op;
+
+    return QJsonDocument(body).toJson(QJsonDocument::Compact) + '\n';
+}
+
+/// 在 SceneData 上重放日志.
+/// 重放是幂等的: 已经存在的节点被替换, 已经存在的连接和不存在的删除目标被
+/// 忽略, 所以合并到一半时崩溃, 同一段日志再重放一次也没有问题
+class SceneReplay {
+   public:
+    explicit SceneReplay(SceneData &scene)
+        : _scene(scene), _converters(scene) {
+        for (std::size_t i = 0; i < scene.nodes.size(); ++i)
+            _nodeIndices.insert(scene.nodes[i].id, i);
+
+        _nodeRemoved.assign(scene.nodes.size(), false);
+
+        for (std::size_t i = 0; i < scene.connections.size(); ++i)
+            _connectionIndices.emplace(key(scene.connections[i]), i);
+
+        _connectionRemoved.assign(scene.connections.size(), false);
+    }
+
+    /// 这一行无法解析时返回 false (通常是崩溃时只写了一半的最后一行)
+    bool apply(QByteArray const &line) {
+        QJsonParseError error;
+        QJsonObject const json = QJsonDocument::fromJson(line, &error).object();
+
+        if (error.error != QJsonParseError::NoError) return false;
+
+        QString const op = json["op"].toString();
+
+        if (op == "addNode") {
+            addNode(nodeRecordFromJson(json["node"].toObject()));
+        } else if (op == "removeNode") {
+            auto it = _nodeIndices.find(QUuid(json["id"].toString()));
+
+            if (it != _nodeIndices.end()) {
+                _nodeRemoved[it.value()] = true;
+                _nodeIndices.erase(it);
+            }
+        } else if (op == "moveNode") {
+            if (SceneNodeRecord *record = node(json["id"])) {
+                record->position =
+                    QPointF(json["x"].toDouble(), json["y"].toDouble());
+            }
+        } else if (op == "updateModel") {
+            if (SceneNodeRecord *record = node(json["id"]))
+                record->model = json["model"].toObject();
+        } else if (op == "addConnection") {
+            addConnection(json["connection"].toObject());
+        } else if (op == "removeConnection") {
+            removeConnection(json["connection"].toObject());
+        }
+
+        return true;
+    }
+
+    /// 去掉删除的节点和连接, 重新编排下标
+    void finish() {
+        std::vector<std::size_t> newIndex(_scene.nodes.size(),
+                                          SceneConnectionRecord::InvalidIndex);
+        std::vector<SceneNodeRecord> nodes;
+
+        for (std::size_t i = 0; i < _scene.nodes.size(); ++i) {
+            if (_nodeRemoved[i]) continue;
+
+            newIndex[i] = nodes.size();
+            nodes.push_back(std::move(_scene.nodes[i]));
+        }
+
+        std::vector<SceneConnectionRecord> connections;
+
+        for (std::size_t i = 0; i < _scene.connections.size(); ++i) {
+            SceneConnectionRecord record = _scene.connections[i];
+
+            if (_connectionRemoved[i] || record.in >= newIndex.size() ||
+                record.out >= newIndex.size())
+                continue;
+
+            record.in = newIndex[record.in];
+            record.out = newIndex[record.out];
+
+            // 连接的一端被删除了
+            if (record.in == SceneConnectionRecord::InvalidIndex ||
+                record.out == SceneConnectionRecord::InvalidIndex)
+                continue;
+
+            connections.push_back(record);
+        }
+
+        _scene.nodes = std::move(nodes);
+        _scene.connections = std::move(connections);
+        _scene.danglingConnections = 0;
+    }
+
+   private:
+    using ConnectionKey =
+        std::tuple<std::size_t, PortIndex, std::size_t, PortIndex>;
+
+    static ConnectionKey key(SceneConnectionRecord const &record) {
+        return ConnectionKey(record.in, record.inPort, record.out,
+                             record.outPort);
+    }
+
+    SceneNodeRecord *node(QJsonValue const &id) {
+        auto it = _nodeIndices.constFind(QUuid(id.toString()));
+
+        return it != _nodeIndices.constEnd() ? &_scene.nodes[it.value()]
+                                             : nullptr;
+    }
+
+    void addNode(SceneNodeRecord record) {
+        auto it = _nodeIndices.constFind(record.id);
+
+        if (it != _nodeIndices.constEnd()) {
+            _scene.nodes[it.value()] = std::move(record);
+            return;
+        }
+
+        _nodeIndices.insert(record.id, _scene.nodes.size());
+        _scene.nodes.push_back(std::move(record));
+        _nodeRemoved.push_back(false);
+    }
+
+    /// 连接两端的节点都存在时返回 true
+    bool connectionRecord(QJsonObject const &json,
+                          SceneConnectionRecord &record) const {
+        auto in = _nodeIndices.constFind(QUuid(json["in_id"].toString()));
+        auto out = _nodeIndices.constFind(QUuid(json["out_id"].toString()));
+
+        if (in == _nodeIndices.constEnd() || out == _nodeIndices.constEnd())
+            return false;
+
+        record.in = in.value();
+        record.inPort = json["in_index"].toInt();
+        record.out = out.value();
+        record.outPort = json["out_index"].toInt();
+
+        return true;
+    }
+
+    void addConnection(QJsonObject const &json) {
+        SceneConnectionRecord record;
+
+        if (!connectionRecord(json, record)) return;
+
+        if (_connectionIndices.count(key(record)) != 0) return;
+
+        QJsonValue const converterJson = json["converter"];
+
+        if (!converterJson.isUndefined()) {
+            QJsonObject const in = converterJson["in"].toObject();
+            QJsonObject const out = converterJson["out"].toObject();
+
+            record.converter = _converters.add(
+                {in["id"].toString(), in["name"].toString()},
+                {out["id"].toString(), out["name"].toString()});
+        }
+
+        _connectionIndices.emplace(key(record), _scene.connections.size());
+        _scene.connections.push_back(record);
+        _connectionRemoved.push_back(false);
+    }
+
+    void removeConnection(QJsonObject const &json) {
+        SceneConnectionRecord record;
+
+        if (!connectionRecord(json, record)) return;
+
+        auto it = _connectionIndices.find(key(record));
+
+        if (it == _connectionIndices.end()) return;
+
+        _connectionRemoved[it->second] = true;
+        _connectionIndices.erase(it);
+    }
+
+   private:
+    SceneData &_scene;
+
+    SceneConverterTable _converters;
+
+    QHash<QUuid, std::size_t> _nodeIndices;
+
+    std::vector<bool> _nodeRemoved;
+
+    std::map<ConnectionKey, std::size_t> _connectionIndices;
+
+    std::vector<bool> _connectionRemoved;
+};
+
+/// 文件不存在时什么也不做
+void replayFile(QString const &fileName, SceneReplay &replay) {
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    while (!file.atEnd()) {
+        QByteArray const line = file.readLine();
+
+        if (line.trimmed().isEmpty()) continue;
+
+        if (!replay.apply(line)) break;
+    }
+}
+
+/// 读取快照 (如果存在) 并依次重放给出的日志
+bool readSnapshot(QString const &fileName, QStringList const &journals,
+                  SceneData &scene) {
+    QFile snapshot(fileName);
+
+    if (snapshot.exists()) {
+        if (!snapshot.open(QIODevice::ReadOnly)) return false;
+
+        if (!readScene(snapshot.readAll(), scene)) return false;
+    }
+
+    SceneReplay replay(scene);
+
+    for (QString const &journal : journals) replayFile(journal, replay);
+
+    replay.finish();
+
+    return true;
+}
+
+/// 在工作线程中执行, 只访问文件
+bool compactFiles(QString const &fileName) {
+    QString const journal = compactingJournalName(fileName);
+
+    SceneData scene;
+
+    if (!readSnapshot(fileName, {journal}, scene)) return false;
+
+    QSaveFile snapshot(fileName);
+
+    if (!snapshot.open(QIODevice::WriteOnly)) return false;
+
+    snapshot.write(writeBinaryScene(scene));
+
+    // 快照替换成功后这段日志才可以删除
+    if (!snapshot.commit()) return false;
+
+    QFile::remove(journal);
+
+    return true;
+}
+}  // namespace
+
+ChangeJournal::ChangeJournal(FlowScene &scene, QString fileName)
+    : QObject(&scene), _scene(scene), _fileName(std::move(fileName)) {
+    _journal.setFileName(journalName(_fileName));
+
+    _flushTimer.setSingleShot(true);
+    _flushTimer.setInterval(1000);
+
+    connect(&_flushTimer, &QTimer::timeout, this, &ChangeJournal::flush);
+}
+
+ChangeJournal::~ChangeJournal() { stop(); }
+
+bool ChangeJournal::start() {
+    stop();
+
+    // 后台的合并也会写快照
+    if (_compacting) return false;
+
+    // 快照和日志中的模型数据一致, 之后只记录变化
+    SceneData const scene = _scene.sceneData();
+
+    QSaveFile snapshot(_fileName);
+
+    if (!snapshot.open(QIODevice::WriteOnly)) return false;
+
+    snapshot.write(writeBinaryScene(scene));
+
+    if (!snapshot.commit()) return false;
+
+    QFile::remove(compactingJournalName(_fileName));
+
+    if (!openJournal(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    _recording = true;
+
+    std::size_t i = 0;
+
+    for (Node &node : _scene._nodes) {
+        _modelStates[node.entityId()] = scene.nodes[i++].model;
+        watchNode(node);
+    }
+
+    connect(&_scene, &FlowScene::nodeCreated, this,
+            &ChangeJournal::onNodeCreated);
+    connect(&_scene, &FlowScene::nodeDeleted, this,
+            &ChangeJournal::onNodeDeleted);
+    connect(&_scene, &FlowScene::connectionCreated, this,
+            &ChangeJournal::onConnectionCreated);
+    connect(&_scene, &FlowScene::connectionDeleted, this,
+            &ChangeJournal::onConnectionDeleted);
+    connect(&_scene, &FlowScene::batchCommitted, this,
+            &ChangeJournal::onBatchCommitted);
+
+    auto onMoved = [this](Node &node) {
+        _movedNodes.insert(&node);
+        scheduleFlush();
+    };
+
+    connect(&_scene, &FlowScene::nodePlaced, this, onMoved);
+    connect(&_scene, &FlowScene::nodeMoved, this,
+            [onMoved](Node &node, QPointF const &) { onMoved(node); });
+
+    return true;
+}
+
+void ChangeJournal::stop() {
+    if (!_recording) return;
+
+    flush();
+
+    disconnect(&_scene, nullptr, this, nullptr);
+
+    for (Node &node : _scene._nodes)
+        disconnect(node.nodeDataModel(), nullptr, this, nullptr);
+
+    _flushTimer.stop();
+    _journal.close();
+
+    _movedNodes.clear();
+    _changedModels.clear();
+    _modelStates.clear();
+
+    _recording = false;
+}
+
+bool ChangeJournal::isRecording() const { return _recording; }
+
+void ChangeJournal::flush() {
+    if (!_recording) return;
+
+    writeBuffer();
+
+    if (_journal.size() > _compactionThreshold) compact();
+}
+
+void ChangeJournal::compact() {
+    if (!_recording || _compacting) return;
+
+    writeBuffer();
+
+    QString const compacting = compactingJournalName(_fileName);
+
+    // 上一次合并失败时旧日志还在, 新的修改继续写进当前日志, 先合并旧的
+    if (!QFile::exists(compacting)) {
+        _journal.close();
+
+        if (!QFile::rename(_journal.fileName(), compacting)) {
+            openJournal(QIODevice::WriteOnly | QIODevice::Append);
+            return;
+        }
+
+        if (!openJournal(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            // 无法继续记录, 旧日志留给 recover()
+            stop();
+            return;
+        }
+    }
+
+    _compacting = true;
+
+    QString const fileName = _fileName;
+
+    runInBackground(
+        this, [fileName]() { return compactFiles(fileName); },
+        [](ChangeJournal &journal, bool success) {
+            journal.finishCompaction(success);
+        });
+}
+
+QString ChangeJournal::fileName() const { return _fileName; }
+
+int ChangeJournal::flushInterval() const { return _flushTimer.interval(); }
+
+void ChangeJournal::setFlushInterval(int milliseconds) {
+    _flushTimer.setInterval(milliseconds);
+}
+
+qint64 ChangeJournal::compactionThreshold() const {
+    return _compactionThreshold;
+}
+
+void ChangeJournal::setCompactionThreshold(qint64 bytes) {
+    _compactionThreshold = bytes;
+}
+
+bool ChangeJournal::recover(FlowScene &scene, QString const &fileName) {
+    SceneData data;
+
+    if (!readSnapshot(fileName,
+                      {compactingJournalName(fileName), journalName(fileName)},
+                      data))
+        return false;
+
+    decodeNodes(data, scene._registry.get());
+
+    scene.restoreScene(data);
+
+    return true;
+}
+
+void ChangeJournal::watchNode(Node &node) {
+    auto onChanged = [this, &node]() {
+        _changedModels.insert(&node);
+        scheduleFlush();
+    };
+
+    connect(node.nodeDataModel(), &NodeDataModel::dataUpdated, this,
+            [onChanged](PortIndex) { onChanged(); });
+    connect(node.nodeDataModel(), &NodeDataModel::stateChanged, this,
+            onChanged);
+}
+
+void ChangeJournal::onNodeCreated(Node &node) {
+    QJsonObject const nodeJson = node.serialize();
+
+    QJsonObject body;
+    body["node"] = nodeJson;
+
+    append(entry("addNode", body));
+
+    _modelStates[node.entityId()] = nodeJson["model"].toObject();
+
+    watchNode(node);
+}
+
+void ChangeJournal::onNodeDeleted(Node &node) {
+    // 之后删除节点的连接时, 模型还会收到空数据并发出 dataUpdated
+    disconnect(node.nodeDataModel(), nullptr, this, nullptr);
+
+    _movedNodes.erase(&node);
+    _changedModels.erase(&node);
+    _modelStates.erase(node.entityId());
+
+    QJsonObject body;
+    body["id"] = node.id().toString();
+
+    append(entry("removeNode", body));
+}
+
+void ChangeJournal::onConnectionCreated(Connection const &connection) {
+    QJsonObject const connectionJson = connection.serialize();
+
+    if (connectionJson.isEmpty()) return;
+
+    QJsonObject body;
+    body["connection"] = connectionJson;
+
+    append(entry("addConnection", body));
+}
+
+void ChangeJournal::onConnectionDeleted(Connection const &connection) {
+    QJsonObject const connectionJson = connection.serialize();
+
+    if (connectionJson.isEmpty()) return;
+
+    QJsonObject body;
+    body["connection"] = connectionJson;
+
+    append(entry("removeConnection", body));
+}
+
+void ChangeJournal::onBatchCommitted(
+    std::vector<Node *> const &nodes,
+    std::vector<Connection *> const &connections) {
+    for (Node *node : nodes) onNodeCreated(*node);
+
+    for (Connection *connection : connections) onConnectionCreated(*connection);
+}
+
+void ChangeJournal::append(QByteArray const &line) {
+    writeCoalesced();
+
+    _buffer += line;
+
+    scheduleFlush();
+}
+
+void ChangeJournal::writeCoalesced() {
+    for (Node *node : _movedNodes) {
+        QPointF const pos = node->position();
+
+        QJsonObject body;
+        body["id"] = node->id().toString();
+        body["x"] = pos.x();
+        body["y"] = pos.y();
+
+        _buffer += entry("moveNode", body);
+    }
+
+    _movedNodes.clear();
+
+    for (Node *node : _changedModels) {
+        QJsonObject const model = node->nodeDataModel()->serialize();
+
+        // 数据更新不一定改变了模型需要保存的内容
+        QJsonObject &lastModel = _modelStates[node->entityId()];
+
+        if (model == lastModel) continue;
+
+        lastModel = model;
+
+        QJsonObject body;
+        body["id"] = node->id().toString();
+        body["model"] = model;
+
+        _buffer += entry("updateModel", body);
+    }
+
+    _changedModels.clear();
+}
+
+void ChangeJournal::writeBuffer() {
+    writeCoalesced();
+
+    if (_buffer.isEmpty()) return;
+
+    _journal.write(_buffer);
+    _journal.flush();
+
+    _buffer.clear();
+}
+
+void ChangeJournal::scheduleFlush() {
+    if (!_flushTimer.isActive()) _flushTimer.start();
+}
+
+bool ChangeJournal::openJournal(QIODevice::OpenMode mode) {
+    _journal.close();
+
+    return _journal.open(mode);
+}
+
+void ChangeJournal::finishCompaction(bool success) {
+    _compacting = false;
+
+    Q_EMIT compacted(success);
+}
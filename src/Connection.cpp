@@ -25,7 +25,7 @@ using QtNodes::PortType;
 using QtNodes::TypeConverter;
 
 Connection::Connection(PortType portType, Node &node, PortIndex portIndex)
-    : _uid(QUuid::createUuid()),
+    : _entityId(QtNodes::nextEntityId()),
       _outPortIndex(INVALID),
       _inPortIndex(INVALID),
       _connectionState() {
@@ -35,7 +35,7 @@ Connection::Connection(PortType portType, Node &node, PortIndex portIndex)
 
 Connection::Connection(Node &nodeIn, PortIndex portIndexIn, Node &nodeOut,
                        PortIndex portIndexOut, TypeConverter typeConverter)
-    : _uid(QUuid::createUuid()),
+    : _entityId(QtNodes::nextEntityId()),
       _outNode(&nodeOut),
       _inNode(&nodeIn),
       _outPortIndex(portIndexOut),
@@ -50,11 +50,11 @@ Connection::~Connection() {
     if (complete()) connectionMadeIncomplete(*this);
     transmitEmptyData();
 
-    if (_inNode) {
+    if (_inNode && _inNode->hasGraphicsObject()) {
         _inNode->nodeGraphicsObject().update();
     }
 
-    if (_outNode) {
+    if (_outNode && _outNode->hasGraphicsObject()) {
         _outNode->nodeGraphicsObject().update();
     }
 }
@@ -91,7 +91,11 @@ QJsonObject Connection::serialize() const {
     return connectionJson;
 }
 
-QUuid Connection::id() const { return _uid; }
+QUuid Connection::id() const {
+    if (_uid.isNull()) _uid = QUuid::createUuid();
+
+    return _uid;
+}
 
 bool Connection::complete() const {
     return _inNode != nullptr && _outNode != nullptr;
@@ -193,11 +197,22 @@ void Connection::setNodeToPort(Node &node, PortType portType,
 
 void Connection::removeFromNodes() const {
     if (_inNode)
-        _inNode->nodeState().eraseConnection(PortType::In, _inPortIndex, id());
+        _inNode->nodeState().eraseConnection(PortType::In, _inPortIndex, *this);
 
     if (_outNode)
         _outNode->nodeState().eraseConnection(PortType::Out, _outPortIndex,
-                                              id());
+                                              *this);
+}
+
+void Connection::detachFromNodes() {
+    removeFromNodes();
+
+    _inNode = nullptr;
+    _outNode = nullptr;
+}
+
+bool Connection::hasGraphicsObject() const {
+    return _connectionGraphicsObject != nullptr;
 }
 
 ConnectionGraphicsObject &Connection::getConnectionGraphicsObject() const {
@@ -296,13 +311,22 @@ void Connection::setTypeConverter(TypeConverter converter) {
     _converter = std::move(converter);
 }
 
+bool Connection::hasTypeConverter() const {
+    return static_cast<bool>(_converter);
+}
+
+std::shared_ptr<NodeData> Connection::convertData(
+    std::shared_ptr<NodeData> nodeData) const {
+    if (_converter) {
+        return _converter(std::move(nodeData));
+    }
+
+    return nodeData;
+}
+
 void Connection::transmitData(std::shared_ptr<NodeData> nodeData) const {
     if (_inNode) {
-        if (_converter) {
-            nodeData = _converter(nodeData);
-        }
-
-        _inNode->transmitData(nodeData, _inPortIndex);
+        _inNode->transmitData(convertData(std::move(nodeData)), _inPortIndex);
     }
 }
 
@@ -22,6 +22,11 @@ const QPointF &ConnectionGeometry::getEndPoint(PortType portType) const {
 }
 
 void ConnectionGeometry::setEndPoint(PortType portType, QPointF const &point) {
+    // 节点移动时另一端的端点通常不变, 保留它的缓存
+    if (portType != PortType::None && getEndPoint(portType) == point) return;
+
+    invalidate();
+
     switch (portType) {
         case PortType::Out:
             _out = point;
@@ -38,6 +43,10 @@ void ConnectionGeometry::setEndPoint(PortType portType, QPointF const &point) {
 
 void ConnectionGeometry::moveEndPoint(PortType portType,
                                       QPointF const &offset) {
+    if (offset.isNull()) return;
+
+    invalidate();
+
     switch (portType) {
         case PortType::Out:
             _out += offset;
@@ -53,6 +62,8 @@ void ConnectionGeometry::moveEndPoint(PortType portType,
 }
 
 QRectF ConnectionGeometry::boundingRect() const {
+    if (_boundingRectValid) return _boundingRect;
+
     auto points = pointsC1C2();
 
     QRectF basicRect = QRectF(_out, _in).normalized();
@@ -70,7 +81,64 @@ QRectF ConnectionGeometry::boundingRect() const {
     commonRect.setTopLeft(commonRect.topLeft() - cornerOffset);
     commonRect.setBottomRight(commonRect.bottomRight() + 2 * cornerOffset);
 
-    return commonRect;
+    _boundingRect = commonRect;
+    _boundingRectValid = true;
+
+    return _boundingRect;
+}
+
+QPainterPath const &ConnectionGeometry::cubicPath() const {
+    if (_cubicPathValid) return _cubicPath;
+
+    auto c1c2 = pointsC1C2();
+
+    // cubic spline
+    QPainterPath cubic(_out);
+
+    cubic.cubicTo(c1c2.first, c1c2.second, _in);
+
+    _cubicPath = cubic;
+    _cubicPathValid = true;
+
+    return _cubicPath;
+}
+
+QPolygonF const &ConnectionGeometry::polyline() const {
+    if (_polylineValid) return _polyline;
+
+    QPainterPath const &cubic = cubicPath();
+
+    _polyline.resize(PolylineSegments + 1);
+
+    for (int i = 0; i <= PolylineSegments; ++i)
+        _polyline[i] = cubic.pointAtPercent(double(i) / PolylineSegments);
+
+    _polylineValid = true;
+
+    return _polyline;
+}
+
+QPainterPath const &ConnectionGeometry::hitShape() const {
+    if (_hitShapeValid) return _hitShape;
+
+    QPainterPath const &cubic = cubicPath();
+
+    QPainterPath result(_out);
+
+    unsigned segments = 20;
+
+    for (auto i = 0ul; i < segments; ++i) {
+        double ratio = double(i + 1) / segments;
+        result.lineTo(cubic.pointAtPercent(ratio));
+    }
+
+    QPainterPathStroker stroker;
+    stroker.setWidth(10.0);
+
+    _hitShape = stroker.createStroke(result);
+    _hitShapeValid = true;
+
+    return _hitShape;
 }
 
 std::pair<QPointF, QPointF> ConnectionGeometry::pointsC1C2() const {
@@ -102,3 +170,10 @@ std::pair<QPointF, QPointF> ConnectionGeometry::pointsC1C2() const {
 
     return std::make_pair(c1, c2);
 }
+
+void ConnectionGeometry::invalidate() {
+    _boundingRectValid = false;
+    _cubicPathValid = false;
+    _hitShapeValid = false;
+    _polylineValid = false;
+}
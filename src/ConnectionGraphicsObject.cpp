@@ -34,9 +34,12 @@ ConnectionGraphicsObject::ConnectionGraphicsObject(FlowScene &scene,
     // addGraphicsEffect();
 
     setZValue(-1.0);
+
+    _scene.indexItem(*this);
 }
 
 ConnectionGraphicsObject::~ConnectionGraphicsObject() {
+    _scene.unindexItem(*this);
     _scene.removeItem(this);
 }
 
@@ -57,9 +60,8 @@ QPainterPath ConnectionGraphicsObject::shape() const {
     // return path;
 
 #else
-    auto const &geom = _connection.connectionGeometry();
-
-    return ConnectionPainter::getPainterStroke(geom);
+    // 悬停检测时每移动一下鼠标都会调用, 直接用缓存的轮廓
+    return _connection.connectionGeometry().hitShape();
 
 #endif
 }
@@ -110,6 +112,8 @@ void ConnectionGraphicsObject::move() {
             _connection.getConnectionGraphicsObject().update();
         }
     }
+
+    _scene.indexItem(*this);
 }
 
 void ConnectionGraphicsObject::lock(bool locked) {
@@ -143,10 +147,21 @@ void ConnectionGraphicsObject::mouseMoveEvent(QGraphicsSceneMouseEvent *event) {
 
     state.interactWithNode(node);
     if (node) {
-        node->reactToPossibleConnection(
-            state.requiredPort(),
-            _connection.dataType(oppositePort(state.requiredPort())),
-            event->scenePos());
+        PortType const attachedPort = oppositePort(state.requiredPort());
+        Node const *attachedNode = _connection.getNode(attachedPort);
+
+        // 连接的类型 id 从已经连上的节点的缓存中取, 绘制端口时只比较整数
+        auto const typeId =
+            attachedNode
+                ? attachedNode->portTypeId(
+                      _scene.registry(), attachedPort,
+                      _connection.getPortIndex(attachedPort))
+                : DataModelRegistry::InvalidTypeId;
+
+        node->reactToPossibleConnection(state.requiredPort(),
+                                        _connection.dataType(attachedPort),
+                                        event->scenePos(), attachedNode,
+                                        typeId);
     }
 
     //-------------------
@@ -157,6 +172,8 @@ void ConnectionGraphicsObject::mouseMoveEvent(QGraphicsSceneMouseEvent *event) {
 
     if (requiredPort != PortType::None) {
         _connection.connectionGeometry().moveEndPoint(requiredPort, offset);
+
+        _scene.indexItem(*this);
     }
 
     //-------------------
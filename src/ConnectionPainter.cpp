@@ -1,5 +1,7 @@
 #include "ConnectionPainter.hpp"
 
+#include <QtWidgets/QStyleOptionGraphicsItem>
+
 #include "Connection.hpp"
 #include "ConnectionGeometry.hpp"
 #include "ConnectionGraphicsObject.hpp"
@@ -9,39 +11,11 @@
 using QtNodes::Connection;
 using QtNodes::ConnectionGeometry;
 using QtNodes::ConnectionPainter;
-
-static QPainterPath cubicPath(ConnectionGeometry const &geom) {
-    QPointF const &source = geom.source();
-    QPointF const &sink = geom.sink();
-
-    auto c1c2 = geom.pointsC1C2();
-
-    // cubic spline
-    QPainterPath cubic(source);
-
-    cubic.cubicTo(c1c2.first, c1c2.second, sink);
-
-    return cubic;
-}
+using QtNodes::FlowViewStyle;
 
 QPainterPath ConnectionPainter::getPainterStroke(
     ConnectionGeometry const &geom) {
-    auto cubic = cubicPath(geom);
-
-    QPointF const &source = geom.source();
-    QPainterPath result(source);
-
-    unsigned segments = 20;
-
-    for (auto i = 0ul; i < segments; ++i) {
-        double ratio = double(i + 1) / segments;
-        result.lineTo(cubic.pointAtPercent(ratio));
-    }
-
-    QPainterPathStroker stroker;
-    stroker.setWidth(10.0);
-
-    return stroker.createStroke(result);
+    return geom.hitShape();
 }
 
 #ifdef NODE_DEBUG_DRAWING
@@ -67,7 +41,7 @@ static void debugDrawing(QPainter *painter, Connection const &connection) {
 
         painter->setBrush(Qt::NoBrush);
 
-        painter->drawPath(cubicPath(geom));
+        painter->drawPath(geom.cubicPath());
     }
 
     {
@@ -98,7 +72,7 @@ static void drawSketchLine(QPainter *painter, Connection const &connection) {
         using QtNodes::ConnectionGeometry;
         ConnectionGeometry const &geom = connection.connectionGeometry();
 
-        auto cubic = cubicPath(geom);
+        QPainterPath const &cubic = geom.cubicPath();
         // cubic spline
         painter->drawPath(cubic);
     }
@@ -131,7 +105,7 @@ static void drawHoveredOrSelected(QPainter *painter,
         painter->setBrush(Qt::NoBrush);
 
         // cubic spline
-        auto cubic = cubicPath(geom);
+        QPainterPath const &cubic = geom.cubicPath();
         painter->drawPath(cubic);
     }
 }
@@ -180,7 +154,6 @@ static void drawNormalLine(QPainter *painter, Connection const &connection) {
     auto const &graphicsObject = connection.getConnectionGraphicsObject();
     bool const selected = graphicsObject.isSelected();
 
-    auto cubic = cubicPath(geom);
     if (gradientColor) {
         painter->setBrush(Qt::NoBrush);
 
@@ -189,33 +162,33 @@ static void drawNormalLine(QPainter *painter, Connection const &connection) {
         p.setColor(c);
         painter->setPen(p);
 
-        unsigned int const segments = 60;
+        // 两种颜色各画一半折线, 折线只在端点移动后重新计算
+        QPolygonF const &points = geom.polyline();
+        int const half = ConnectionGeometry::PolylineSegments / 2;
 
-        for (unsigned int i = 0ul; i < segments; ++i) {
-            double ratioPrev = double(i) / segments;
-            double ratio = double(i + 1) / segments;
+        painter->drawPolyline(points.constData(), half + 1);
 
-            if (i == segments / 2) {
-                QColor color_in = normalColorIn;
-                if (selected) color_in = color_in.lighter(120);
+        QColor color_in = normalColorIn;
+        if (selected) color_in = color_in.lighter(120);
 
-                p.setColor(color_in);
-                painter->setPen(p);
-            }
-            painter->drawLine(cubic.pointAtPercent(ratioPrev),
-                              cubic.pointAtPercent(ratio));
-        }
+        p.setColor(color_in);
+        painter->setPen(p);
+
+        painter->drawPolyline(points.constData() + half,
+                              int(points.size()) - half);
+
+        QPointF const middle = points[half];
 
         {
             painter->setBrush(QBrush(QColor(0, 120, 214)));
             painter->setPen(Qt::NoPen);
-            painter->drawEllipse(cubic.pointAtPercent(0.5), 8, 8);
+            painter->drawEllipse(middle, 8, 8);
             painter->setBrush(Qt::NoBrush);
             QPen pen = QPen();
             pen.setWidthF(1);
             pen.setColor(QColor(100, 150, 255));
             painter->setPen(pen);
-            painter->drawEllipse(cubic.pointAtPercent(0.5), 13, 13);
+            painter->drawEllipse(middle, 13, 13);
         }
     } else {
         p.setColor(normalColorOut);
@@ -227,11 +200,45 @@ static void drawNormalLine(QPainter *painter, Connection const &connection) {
         painter->setPen(p);
         painter->setBrush(Qt::NoBrush);
 
-        painter->drawPath(cubic);
+        painter->drawPath(geom.cubicPath());
     }
 }
 
+/// 缩小到 FlowViewStyle::DetailLevel::Dot 时, 连接只画一条细直线
+static void drawStraightLine(QPainter *painter, Connection const &connection) {
+    auto const &connectionStyle = QtNodes::StyleCollection::connectionStyle();
+
+    ConnectionGeometry const &geom = connection.connectionGeometry();
+
+    bool const selected =
+        connection.getConnectionGraphicsObject().isSelected();
+
+    QColor color = connectionStyle.normalColor();
+
+    if (connection.connectionState().requiresPort())
+        color = connectionStyle.constructionColor();
+    else if (selected)
+        color = connectionStyle.selectedColor();
+    else if (connectionStyle.useDataDefinedColors())
+        color = QtNodes::ConnectionStyle::normalColor(
+            connection.dataType(QtNodes::PortType::Out).id);
+
+    // 宽度为 0 的画笔总是一个像素宽, 不受缩放影响
+    painter->setPen(QPen(color, 0));
+    painter->setBrush(Qt::NoBrush);
+    painter->drawLine(geom.source(), geom.sink());
+}
+
 void ConnectionPainter::paint(QPainter *painter, Connection const &connection) {
+    auto const level = QtNodes::StyleCollection::flowViewStyle().detailLevel(
+        QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+            painter->worldTransform()));
+
+    if (level == FlowViewStyle::DetailLevel::Dot) {
+        drawStraightLine(painter, connection);
+        return;
+    }
+
     drawHoveredOrSelected(painter, connection);
 
     drawSketchLine(painter, connection);
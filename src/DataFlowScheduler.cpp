@@ -0,0 +1,105 @@
+#include "DataFlowScheduler.hpp"
+
+#include <QtCore/QMetaObject>
+#include <algorithm>
+#include <functional>
+
+#include "FlowScene.hpp"
+#include "Node.hpp"
+#include "TopologicalOrder.hpp"
+
+using QtNodes::DataFlowScheduler;
+using QtNodes::FlowScene;
+using QtNodes::Node;
+using QtNodes::PortIndex;
+using QtNodes::PortType;
+using QtNodes::TopologicalOrder;
+
+DataFlowScheduler::DataFlowScheduler(FlowScene &scene,
+                                     TopologicalOrder const &order)
+    : _scene(scene), _order(order) {}
+
+void DataFlowScheduler::setDeferred(bool deferred) {
+    // 切回同步模式前先把积压的数据传播出去
+    if (!deferred) flush();
+
+    _deferred = deferred;
+}
+
+void DataFlowScheduler::suspend() { ++_suspended; }
+
+void DataFlowScheduler::resume() {
+    Q_ASSERT(_suspended > 0);
+
+    if (--_suspended == 0) flush();
+}
+
+void DataFlowScheduler::markDirty(Node &node, PortIndex portIndex) {
+    auto inserted = _dirty.emplace(&node, std::vector<bool>());
+    auto &ports = inserted.first->second;
+
+    if (inserted.second) {
+        _queue.emplace_back(_order.position(node), &node);
+        std::push_heap(_queue.begin(), _queue.end(), std::greater<>());
+    }
+
+    ports.resize(node.nodeState().getEntries(PortType::Out).size(), false);
+
+    if (portIndex >= 0 && static_cast<size_t>(portIndex) < ports.size())
+        ports[portIndex] = true;
+
+    if (_suspended == 0) scheduleFlush();
+}
+
+void DataFlowScheduler::forget(Node const &node) {
+    _dirty.erase(const_cast<Node *>(&node));
+}
+
+void DataFlowScheduler::flush() {
+    if (_flushing || _suspended != 0) return;
+
+    _flushing = true;
+    _flushScheduled = false;
+
+    // 标记之后拓扑顺序可能变了, 按当前的位置重建队列
+    _queue.clear();
+
+    for (auto const &pair : _dirty)
+        _queue.emplace_back(_order.position(*pair.first), pair.first);
+
+    std::make_heap(_queue.begin(), _queue.end(), std::greater<>());
+
+    // 传播过程中下游节点会再次被标记, 它们在拓扑顺序中总是排在后面,
+    // 所以每个节点只会在所有上游节点处理完之后被处理一次
+    while (!_queue.empty()) {
+        std::pop_heap(_queue.begin(), _queue.end(), std::greater<>());
+        Node *node = _queue.back().second;
+        _queue.pop_back();
+
+        auto it = _dirty.find(node);
+
+        if (it == _dirty.end()) continue;
+
+        std::vector<bool> ports = std::move(it->second);
+        _dirty.erase(it);
+
+        for (size_t i = 0; i < ports.size(); ++i) {
+            if (ports[i]) node->propagateData(PortIndex(i));
+        }
+    }
+
+    _flushing = false;
+}
+
+void DataFlowScheduler::scheduleFlush() {
+    if (_flushing || _flushScheduled) return;
+
+    _flushScheduled = true;
+
+    QMetaObject::invokeMethod(
+        &_scene,
+        [this]() {
+            if (_flushScheduled) flush();
+        },
+        Qt::QueuedConnection);
+}
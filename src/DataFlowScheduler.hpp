@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "PortType.hpp"
+
+namespace QtNodes {
+
+class FlowScene;
+
+class Node;
+
+class TopologicalOrder;
+
+/// 延迟的数据传播调度器.
+/// 节点输出端口更新时只把节点标记为"脏", 在下一次事件循环或者显式调用
+/// flush() 的时候再按拓扑顺序统一传播, 每个节点在一次传播中最多向下游转发一次.
+class DataFlowScheduler {
+   public:
+    DataFlowScheduler(FlowScene &scene, TopologicalOrder const &order);
+
+    /// 延迟模式, 暂停期间或者 flush() 进行中, 更新只做标记.
+    /// flush() 中下游节点的更新也要排队, 否则它们会在这里同步地向下递归,
+    /// 之后出队时又传播一遍
+    bool deferred() const { return _deferred || _suspended != 0 || _flushing; }
+
+    void setDeferred(bool deferred);
+
+    /// 暂停传播, 可以嵌套. 暂停期间 flush() 不做任何事
+    void suspend();
+
+    /// 最外层的 resume() 立即按拓扑顺序传播暂停期间积压的所有更新
+    void resume();
+
+    /// 标记节点的输出端口需要向下游传播
+    void markDirty(Node &node, PortIndex portIndex);
+
+    /// 节点即将被删除, 丢弃它的待传播状态
+    void forget(Node const &node);
+
+    /// 按拓扑顺序传播所有被标记的节点
+    void flush();
+
+   private:
+    void scheduleFlush();
+
+   private:
+    FlowScene &_scene;
+
+    TopologicalOrder const &_order;
+
+    bool _deferred = false;
+
+    bool _flushing = false;
+
+    bool _flushScheduled = false;
+
+    unsigned int _suspended = 0;
+
+    /// 节点 => 每个输出端口是否需要传播
+    std::unordered_map<Node *, std::vector<bool>> _dirty;
+
+    /// 按拓扑位置排序的待处理节点 (位置, 节点), 可能含有已处理过的条目.
+    /// 标记之后新建的连接可能改变节点的位置, 所以 flush() 开始时会重建
+    std::vector<std::pair<std::size_t, Node *>> _queue;
+};
+}  // namespace QtNodes
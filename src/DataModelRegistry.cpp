@@ -6,7 +6,38 @@
 using QtNodes::DataModelRegistry;
 using QtNodes::NodeDataModel;
 using QtNodes::NodeDataType;
+using QtNodes::PortIndex;
+using QtNodes::PortType;
 using QtNodes::TypeConverter;
+using QtNodes::TypeConverterId;
+
+namespace {
+
+std::uint64_t converterKey(DataModelRegistry::TypeId d1,
+                           DataModelRegistry::TypeId d2) {
+    return (static_cast<std::uint64_t>(d1) << 32) | d2;
+}
+}  // namespace
+
+void DataModelRegistry::registerTypeConverter(TypeConverterId const &id,
+                                              TypeConverter typeConverter) {
+    TypeId const d1 = internType(id.first.id);
+    TypeId const d2 = internType(id.second.id);
+
+    _registeredTypeConverters[converterKey(d1, d2)] = std::move(typeConverter);
+}
+
+void DataModelRegistry::registerPayloadParser(QString const &modelName,
+                                              PayloadParser parser) {
+    _payloadParsers[modelName] = std::move(parser);
+}
+
+DataModelRegistry::PayloadParser const *DataModelRegistry::payloadParser(
+    QString const &modelName) const {
+    auto it = _payloadParsers.find(modelName);
+
+    return it != _payloadParsers.end() ? &it->second : nullptr;
+}
 
 std::unique_ptr<NodeDataModel> DataModelRegistry::create(
     QString const &modelName) {
@@ -35,13 +66,65 @@ DataModelRegistry::CategoriesSet const &DataModelRegistry::categories() const {
 
 TypeConverter DataModelRegistry::getTypeConverter(
     NodeDataType const &d1, NodeDataType const &d2) const {
-    TypeConverterId converterId = std::make_pair(d1, d2);
-
-    auto it = _registeredTypeConverters.find(converterId);
-
-    if (it != _registeredTypeConverters.end()) {
-        return it->second;
+    if (auto converter = findTypeConverter(typeId(d1), typeId(d2))) {
+        return *converter;
     }
 
     return TypeConverter{};
 }
+
+DataModelRegistry::TypeId DataModelRegistry::typeId(
+    NodeDataType const &type) const {
+    auto it = _typeIds.find(type.id);
+
+    return (it != _typeIds.end()) ? it->second : InvalidTypeId;
+}
+
+TypeConverter const *DataModelRegistry::findTypeConverter(TypeId d1,
+                                                          TypeId d2) const {
+    if (d1 == InvalidTypeId || d2 == InvalidTypeId) return nullptr;
+
+    auto it = _registeredTypeConverters.find(converterKey(d1, d2));
+
+    return (it != _registeredTypeConverters.end()) ? &it->second : nullptr;
+}
+
+bool DataModelRegistry::canConvert(NodeDataType const &d1,
+                                   NodeDataType const &d2) const {
+    TypeId const id1 = typeId(d1);
+    TypeId const id2 = typeId(d2);
+
+    // 没有注册过的类型只能和同名的类型连接
+    if (id1 == InvalidTypeId || id2 == InvalidTypeId) return d1.id == d2.id;
+
+    return canConvert(id1, id2);
+}
+
+bool DataModelRegistry::canConvert(TypeId d1, TypeId d2) const {
+    if (d1 == InvalidTypeId || d2 == InvalidTypeId) return false;
+
+    return (d1 == d2) || findTypeConverter(d1, d2) != nullptr;
+}
+
+std::size_t DataModelRegistry::typeCount() const { return _typeIds.size(); }
+
+DataModelRegistry::TypeId DataModelRegistry::internType(QString const &id) {
+    auto it = _typeIds.find(id);
+
+    if (it != _typeIds.end()) return it->second;
+
+    auto const newId = static_cast<TypeId>(_typeIds.size() + 1);
+
+    _typeIds.emplace(id, newId);
+
+    return newId;
+}
+
+void DataModelRegistry::internPortTypes(NodeDataModel const &model) {
+    for (PortType portType : {PortType::In, PortType::Out}) {
+        unsigned int const n = model.nPorts(portType);
+
+        for (unsigned int i = 0; i < n; ++i)
+            internType(model.dataType(portType, PortIndex(i)).id);
+    }
+}
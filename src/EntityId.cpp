@@ -0,0 +1,9 @@
+#include "EntityId.hpp"
+
+#include <atomic>
+
+QtNodes::EntityId QtNodes::nextEntityId() {
+    static std::atomic<EntityId> counter{0};
+
+    return ++counter;
+}
@@ -10,35 +10,66 @@
 #include <QtCore/QJsonObject>
 #include <QtCore/QtGlobal>
 #include <QtWidgets/QFileDialog>
+#include <QtWidgets/QGraphicsView>
 #include <QtWidgets/QGraphicsSceneMoveEvent>
+#include <algorithm>
 #include <stdexcept>
+#include <unordered_set>
 #include <utility>
 
+#include "ChangeJournal.hpp"
 #include "Connection.hpp"
 #include "ConnectionGraphicsObject.hpp"
+#include "DataFlowScheduler.hpp"
 #include "DataModelRegistry.hpp"
 #include "FlowView.hpp"
 #include "Node.hpp"
 #include "NodeGraphicsObject.hpp"
-
+#include "NodeProfiler.hpp"
+#include "ParallelExecutor.hpp"
+#include "SceneData.hpp"
+#include "SceneLoader.hpp"
+#include "SpatialIndex.hpp"
+#include "TopologicalOrder.hpp"
+
+using QtNodes::ChangeJournal;
 using QtNodes::Connection;
 using QtNodes::DataModelRegistry;
 using QtNodes::FlowScene;
 using QtNodes::Node;
 using QtNodes::NodeDataModel;
 using QtNodes::NodeGraphicsObject;
+using QtNodes::NodeProfile;
+using QtNodes::NodeProfiler;
+using QtNodes::NodeState;
 using QtNodes::PortIndex;
 using QtNodes::PortType;
+using QtNodes::SceneConnectionRecord;
+using QtNodes::SceneConverterTable;
+using QtNodes::SceneData;
+using QtNodes::SceneLoader;
+using QtNodes::SceneNodeRecord;
+using QtNodes::SlotHandle;
+using QtNodes::SpatialIndex;
 using QtNodes::TypeConverter;
 
 FlowScene::FlowScene(std::shared_ptr<DataModelRegistry> registry,
                      QObject *parent)
-    : QGraphicsScene(parent), _registry(std::move(registry)) {
+    : QGraphicsScene(parent),
+      _spatialIndex(detail::make_unique<SpatialIndex>()),
+      _registry(std::move(registry)),
+      _topologicalOrder(detail::make_unique<TopologicalOrder>()),
+      _scheduler(
+          detail::make_unique<DataFlowScheduler>(*this, *_topologicalOrder)) {
+    // 编辑器自己的查询 (命中检测, 悬停, 框选) 都用 _spatialIndex;
+    // Qt 的 BSP 索引在拖动节点时要不断重建, 所以仍然不用
     setItemIndexMethod(QGraphicsScene::NoIndex);
 
     // This connection should come first
     connect(this, &FlowScene::connectionCreated, this,
             &FlowScene::setupConnectionSignals);
+    connect(this, &FlowScene::connectionCreated, this,
+            &FlowScene::updateTopologicalOrder);
     connect(this, &FlowScene::connectionCreated, this,
             &FlowScene::sendConnectionCreatedToNodes);
     connect(this, &FlowScene::connectionDeleted, this,
@@ -48,7 +79,14 @@ FlowScene::FlowScene(std::shared_ptr<DataModelRegistry> registry,
 FlowScene::FlowScene(QObject *parent)
     : FlowScene(std::make_shared<DataModelRegistry>(), parent) {}
 
-FlowScene::~FlowScene() { clearScene(); }
+FlowScene::~FlowScene() {
+    // 销毁场景时删除节点不是对场景的修改, 不能记进日志
+    for (ChangeJournal *journal :
+         findChildren<ChangeJournal *>(Qt::FindDirectChildrenOnly))
+        journal->stop();
+
+    clearScene();
+}
 
 //------------------------------------------------------------------------------
 
@@ -64,7 +102,7 @@ std::shared_ptr<Connection> FlowScene::createConnection(PortType connectedPort,
     // after this function connection points are set to node port
     connection->setGraphicsObject(std::move(cgo));
 
-    _connections[connection->id()] = connection;
+    addConnection(connection);
 
     // Note: this connection isn't truly created yet. It's only partially
     // created. Thus, don't send the connectionCreated(...) signal.
@@ -78,24 +116,41 @@ std::shared_ptr<Connection> FlowScene::createConnection(PortType connectedPort,
 std::shared_ptr<Connection> FlowScene::createConnection(
     Node &nodeIn, PortIndex portIndexIn, Node &nodeOut, PortIndex portIndexOut,
     TypeConverter const &converter) {
+    if (wouldCreateCycle(nodeOut, nodeIn)) {
+        qWarning() << "Rejected a connection that would create a cycle";
+        return nullptr;
+    }
+
     auto connection = std::make_shared<Connection>(nodeIn, portIndexIn, nodeOut,
                                                    portIndexOut, converter);
 
-    auto cgo =
-        detail::make_unique<ConnectionGraphicsObject>(*this, *connection);
-
     nodeIn.nodeState().setConnection(PortType::In, portIndexIn, *connection);
     nodeOut.nodeState().setConnection(PortType::Out, portIndexOut, *connection);
 
-    // after this function connection points are set to node port
-    connection->setGraphicsObject(std::move(cgo));
+    if (!_headless) {
+        auto cgo =
+            detail::make_unique<ConnectionGraphicsObject>(*this, *connection);
+
+        // after this function connection points are set to node port
+        connection->setGraphicsObject(std::move(cgo));
+    }
 
     // trigger data propagation
+    // (批量构建时只是标记, 提交时统一传播)
     nodeOut.onDataUpdated(portIndexOut);
 
-    _connections[connection->id()] = connection;
+    addConnection(connection);
 
-    connectionCreated(*connection);
+    if (inBatch()) {
+        // 不发 connectionCreated, 直接做场景自己需要的部分
+        setupConnectionSignals(*connection);
+        updateTopologicalOrder(*connection);
+
+        _batchConnections.emplace_back(connection.get(),
+                                       connection->entityId());
+    } else {
+        connectionCreated(*connection);
+    }
 
     return connection;
 }
@@ -108,8 +163,13 @@ std::shared_ptr<Connection> FlowScene::restoreConnection(
     PortIndex portIndexIn = connectionJson["in_index"].toInt();
     PortIndex portIndexOut = connectionJson["out_index"].toInt();
 
-    auto nodeIn = _nodes[nodeInId].get();
-    auto nodeOut = _nodes[nodeOutId].get();
+    auto nodeIn = nodeById(nodeInId);
+    auto nodeOut = nodeById(nodeOutId);
+
+    if (!nodeIn || !nodeOut) {
+        qWarning() << "Connection refers to a node that does not exist";
+        return nullptr;
+    }
 
     auto getConverter = [&]() {
         QJsonValue converterVal = connectionJson["converter"];
@@ -142,177 +202,426 @@ std::shared_ptr<Connection> FlowScene::restoreConnection(
     return connection;
 }
 
+void FlowScene::addConnection(std::shared_ptr<Connection> const &connection) {
+    _connectionIndex[connection->entityId()] = _connections.emplace(connection);
+}
+
 void FlowScene::deleteConnection(Connection &connection) {
-    auto it = _connections.find(connection.id());
-    if (it != _connections.end()) {
+    auto it = _connectionIndex.find(connection.entityId());
+    if (it != _connectionIndex.end()) {
+        SlotHandle handle = it->second;
+
         connection.removeFromNodes();
-        _connections.erase(it);
+        _connectionIndex.erase(it);
+
+        if (inBatch()) _batchRemoved.insert(connection.entityId());
+
+        // 可能是最后一个引用, 之后不能再访问 connection
+        _connections.erase(handle);
     }
 }
 
 Node &FlowScene::createNode(std::unique_ptr<NodeDataModel> &&dataModel) {
-    auto node = detail::make_unique<Node>(std::move(dataModel));
-    auto ngo = detail::make_unique<NodeGraphicsObject>(*this, *node);
+    Node &node = makeNode(std::move(dataModel));
 
-    node->setGraphicsObject(std::move(ngo));
+    _topologicalOrder->addNode(node);
 
-    auto nodePtr = node.get();
-    _nodes[node->id()] = std::move(node);
+    if (inBatch())
+        _batchNodes.emplace_back(&node, node.entityId());
+    else
+        nodeCreated(node);
 
-    nodeCreated(*nodePtr);
-    return *nodePtr;
+    return node;
 }
 
 Node &FlowScene::restoreNode(QJsonObject const &nodeJson) {
-    QString modelName = nodeJson["model"].toObject()["name"].toString();
+    return restoreNode(nodeRecordFromJson(nodeJson));
+}
 
-    auto dataModel = registry().create(modelName);
+Node &FlowScene::restoreNode(SceneNodeRecord const &record) {
+    auto dataModel = registry().create(record.modelName);
 
     if (!dataModel)
         throw std::logic_error(std::string("No registered model with name ") +
-                               modelName.toLocal8Bit().data());
+                               record.modelName.toLocal8Bit().data());
+
+    Node &node = makeNode(std::move(dataModel));
+
+    // 模型在反序列化时就可能发出数据更新, 延迟模式需要节点已经在拓扑顺序中
+    _topologicalOrder->addNode(node);
+
+    // 反序列化设置 id 时节点会自己加入索引
+    node.unserialize(record.id, record.position, record.model, record.payload);
+
+    if (inBatch()) {
+        _batchNodes.emplace_back(&node, node.entityId());
+    } else {
+        nodePlaced(node);
+        nodeCreated(node);
+    }
+
+    return node;
+}
+
+Node &FlowScene::makeNode(std::unique_ptr<NodeDataModel> &&dataModel) {
+    Node &node = *_nodes.get(_nodes.emplace(std::move(dataModel)));
+    node.setScheduler(_scheduler.get());
+    node.setProfiler(_profiler.get());
+
+    // 节点的 id 在第一次用到时才生成, 生成或者反序列化时再加入索引
+    node.setIdChangedCallback([this](Node const &n, QUuid const &oldId) {
+        SlotHandle const handle = _nodes.handleOf(n);
+
+        auto old = _nodeIndex.find(oldId);
+
+        if (old != _nodeIndex.end() && old->second == handle)
+            _nodeIndex.erase(old);
+
+        _nodeIndex[n.id()] = handle;
+    });
+
+    if (!_headless) {
+        auto ngo = detail::make_unique<NodeGraphicsObject>(*this, node);
+        node.setGraphicsObject(std::move(ngo));
+    }
+
+    Node *nodePtr = &node;
+    NodeDataModel *model = node.nodeDataModel();
+
+    connect(model, &NodeDataModel::computingStarted, this,
+            [this, nodePtr]() { setNodeComputing(*nodePtr, true); });
+    connect(model, &NodeDataModel::computingFinished, this,
+            [this, nodePtr]() { setNodeComputing(*nodePtr, false); });
+
+    return node;
+}
 
-    auto node = detail::make_unique<Node>(std::move(dataModel));
-    auto ngo = detail::make_unique<NodeGraphicsObject>(*this, *node);
-    node->setGraphicsObject(std::move(ngo));
+Node *FlowScene::nodeById(QUuid const &id) const {
+    auto it = _nodeIndex.find(id);
 
-    node->unserialize(nodeJson);
+    if (it == _nodeIndex.end()) return nullptr;
 
-    auto nodePtr = node.get();
-    _nodes[node->id()] = std::move(node);
+    return const_cast<Node *>(_nodes.get(it->second));
+}
+
+void FlowScene::setNodeComputing(Node &node, bool computing) {
+    NodeState &state = node.nodeState();
+
+    if (state.computing() == computing) return;
+
+    state.setComputing(computing);
+
+    if (computing)
+        ++_computingNodeCount;
+    else
+        --_computingNodeCount;
+
+    if (node.hasGraphicsObject()) node.nodeGraphicsObject().update();
+
+    if (computing)
+        nodeComputingStarted(node);
+    else
+        nodeComputingFinished(node);
+}
+
+void FlowScene::indexItem(QGraphicsItem &item) {
+    _spatialIndex->insert(&item, item.sceneBoundingRect());
+}
 
-    nodePlaced(*nodePtr);
-    nodeCreated(*nodePtr);
-    return *nodePtr;
+void FlowScene::unindexItem(QGraphicsItem &item) {
+    if (_spatialIndex) _spatialIndex->remove(&item);
 }
 
 void FlowScene::removeNode(Node &node) {
     // call signal
     nodeDeleted(node);
 
+    if (node.nodeState().computing()) --_computingNodeCount;
+
     for (auto portType : {PortType::In, PortType::Out}) {
-        auto nodeState = node.nodeState();
-        auto const &nodeEntries = nodeState.getEntries(portType);
+        auto const &nodeEntries = node.nodeState().getEntries(portType);
+
+        // 删除连接会修改端口上的列表, 所以先复制一份.
+        // 复制一般不分配内存, 端口上的连接通常不超过两个
+        for (auto const &entry : nodeEntries) {
+            auto const connections = entry;
+
+            for (Connection *c : connections) deleteConnection(*c);
+        }
+    }
+
+    eraseNode(node);
+}
+
+void FlowScene::removeNodes(std::vector<Node *> const &nodes) {
+    std::unordered_set<Node const *> const removed(nodes.begin(),
+                                                   nodes.end());
+
+    for (Node *node : nodes) nodeDeleted(*node);
+
+    // 收集所有相关的连接, 两端都被删除的连接只收集一次
+    std::vector<Connection *> connections;
+    std::unordered_set<Connection const *> collected;
+
+    for (Node *node : nodes) {
+        for (auto portType : {PortType::In, PortType::Out}) {
+            for (auto const &entry : node->nodeState().getEntries(portType)) {
+                for (Connection *c : entry) {
+                    if (collected.insert(c).second) connections.push_back(c);
+                }
+            }
+        }
+    }
 
-        for (auto &connections : nodeEntries) {
-            for (auto const &pair : connections) deleteConnection(*pair.second);
+    // 留下的节点收到空数据后统一传播一次
+    _scheduler->suspend();
+
+    for (Connection *c : connections) {
+        Node *in = c->getNode(PortType::In);
+
+        if (in && removed.count(in) == 0) {
+            // 下游节点留下, 按正常流程删除, 让它收到空数据
+            deleteConnection(*c);
+            continue;
         }
+
+        auto it = _connectionIndex.find(c->entityId());
+
+        if (it == _connectionIndex.end()) continue;
+
+        SlotHandle handle = it->second;
+        _connectionIndex.erase(it);
+
+        // 下游节点也要删除, 不必再发送空数据. 但信号照常发出
+        if (c->complete()) connectionDeleted(*c);
+
+        c->detachFromNodes();
+
+        if (inBatch()) _batchRemoved.insert(c->entityId());
+
+        _connections.erase(handle);
+    }
+
+    for (Node *node : nodes) {
+        if (node->nodeState().computing()) --_computingNodeCount;
+
+        eraseNode(*node);
     }
 
-    _nodes.erase(node.id());
+    _scheduler->resume();
+}
+
+void FlowScene::eraseNode(Node &node) {
+    if (inBatch()) _batchRemoved.insert(node.entityId());
+
+    // 删除连接时节点可能又被标记了, 所以放在最后
+    _scheduler->forget(node);
+    _topologicalOrder->removeNode(node);
+
+    if (node.hasId()) _nodeIndex.erase(node.id());
+
+    _nodes.erase(_nodes.handleOf(node));
 }
 
 DataModelRegistry &FlowScene::registry() const { return *_registry; }
 
 void FlowScene::setRegistry(std::shared_ptr<DataModelRegistry> registry) {
     _registry = std::move(registry);
+
+    for (Node &node : _nodes) node.invalidatePortTypeIds();
 }
 
 void FlowScene::iterateOverNodes(std::function<void(Node *)> const &visitor) {
-    for (const auto &_node : _nodes) {
-        visitor(_node.second.get());
+    for (Node &node : _nodes) {
+        visitor(&node);
     }
 }
 
 void FlowScene::iterateOverNodeData(
     std::function<void(NodeDataModel *)> const &visitor) {
-    for (const auto &_node : _nodes) {
-        visitor(_node.second->nodeDataModel());
+    for (Node &node : _nodes) {
+        visitor(node.nodeDataModel());
     }
 }
 
 void FlowScene::iterateOverNodeDataDependentOrder(
     std::function<void(NodeDataModel *)> const &visitor) {
-    std::set<QUuid> visitedNodesSet;
-
-    // A leaf node is a node with no input ports, or all possible input ports
-    // empty
-    auto isNodeLeaf = [](Node const &node, NodeDataModel const &model) {
-        for (unsigned int i = 0; i < model.nPorts(PortType::In); ++i) {
-            auto connections = node.nodeState().connections(PortType::In, i);
-            if (!connections.empty()) {
-                return false;
-            }
-        }
+    for (Node *node : _topologicalOrder->nodes()) {
+        if (node) visitor(node->nodeDataModel());
+    }
+}
 
-        return true;
-    };
+bool FlowScene::wouldCreateCycle(Node const &nodeOut,
+                                 Node const &nodeIn) const {
+    return _topologicalOrder->wouldCreateCycle(nodeOut, nodeIn);
+}
 
-    // Iterate over "leaf" nodes
-    for (auto const &_node : _nodes) {
-        auto const &node = _node.second;
-        auto model = node->nodeDataModel();
+QPointF FlowScene::getNodePosition(const Node &node) const {
+    return node.position();
+}
 
-        if (isNodeLeaf(*node, *model)) {
-            visitor(model);
-            visitedNodesSet.insert(node->id());
-        }
+void FlowScene::setNodePosition(Node &node, const QPointF &pos) const {
+    node.setPosition(pos);
+}
+
+QSizeF FlowScene::getNodeSize(const Node &node) const {
+    return QSizeF(node.nodeGeometry().width(), node.nodeGeometry().height());
+}
+
+void FlowScene::setHeadless(bool headless) {
+    Q_ASSERT(_nodes.empty() && _connections.empty());
+
+    _headless = headless;
+}
+
+bool FlowScene::isHeadless() const { return _headless; }
+
+void FlowScene::setPropagationMode(PropagationMode mode) {
+    _scheduler->setDeferred(mode == PropagationMode::Deferred);
+}
+
+FlowScene::PropagationMode FlowScene::propagationMode() const {
+    return _scheduler->deferred() ? PropagationMode::Deferred
+                                  : PropagationMode::Immediate;
+}
+
+void FlowScene::flush() { _scheduler->flush(); }
+
+void FlowScene::beginBatch() {
+    if (_batchDepth++ > 0) return;
+
+    _scheduler->suspend();
+
+    for (QGraphicsView *view : views())
+        view->viewport()->setUpdatesEnabled(false);
+}
+
+void FlowScene::commitBatch() {
+    Q_ASSERT(_batchDepth > 0);
+
+    if (--_batchDepth > 0) return;
+
+    std::vector<Node *> nodes;
+    std::vector<Connection *> connections;
+
+    nodes.reserve(_batchNodes.size());
+    connections.reserve(_batchConnections.size());
+
+    for (auto const &entry : _batchNodes) {
+        if (_batchRemoved.count(entry.second) == 0)
+            nodes.push_back(entry.first);
     }
 
-    auto areNodeInputsVisitedBefore = [&](Node const &node,
-                                          NodeDataModel const &model) {
-        for (size_t i = 0; i < model.nPorts(PortType::In); ++i) {
-            auto connections = node.nodeState().connections(PortType::In, i);
+    for (auto const &entry : _batchConnections) {
+        if (_batchRemoved.count(entry.second) == 0)
+            connections.push_back(entry.first);
+    }
 
-            for (auto &conn : connections) {
-                if (visitedNodesSet.find(
-                        conn.second->getNode(PortType::Out)->id()) ==
-                    visitedNodesSet.end()) {
-                    return false;
-                }
-            }
-        }
+    _batchNodes.clear();
+    _batchConnections.clear();
+    _batchRemoved.clear();
 
-        return true;
-    };
+    for (Connection *c : connections) sendConnectionCreatedToNodes(*c);
 
-    // Iterate over dependent nodes
-    while (_nodes.size() != visitedNodesSet.size()) {
-        for (auto const &_node : _nodes) {
-            auto const &node = _node.second;
-            if (visitedNodesSet.find(node->id()) != visitedNodesSet.end())
-                continue;
+    _scheduler->resume();
 
-            auto model = node->nodeDataModel();
+    for (QGraphicsView *view : views()) {
+        view->viewport()->setUpdatesEnabled(true);
+        view->viewport()->update();
+    }
 
-            if (areNodeInputsVisitedBefore(*node, *model)) {
-                visitor(model);
-                visitedNodesSet.insert(node->id());
-            }
-        }
+    batchCommitted(nodes, connections);
+}
+
+bool FlowScene::inBatch() const { return _batchDepth > 0; }
+
+std::size_t FlowScene::computingNodeCount() const {
+    return _computingNodeCount;
+}
+
+void FlowScene::setProfilingEnabled(bool enabled) {
+    if (enabled == isProfilingEnabled()) return;
+
+    _profiler = enabled ? detail::make_unique<NodeProfiler>() : nullptr;
+
+    // 关闭时保留已经收集的统计, 重新打开时从零开始
+    for (Node &node : _nodes) {
+        node.setProfiler(_profiler.get());
+
+        if (enabled) node.resetProfile();
     }
+
+    if (_profileOverlayVisible) update();
 }
 
-QPointF FlowScene::getNodePosition(const Node &node) const {
-    return node.nodeGraphicsObject().pos();
+bool FlowScene::isProfilingEnabled() const { return _profiler != nullptr; }
+
+NodeProfile const &FlowScene::nodeProfile(Node const &node) const {
+    return node.profile();
 }
 
-void FlowScene::setNodePosition(Node &node, const QPointF &pos) const {
-    node.nodeGraphicsObject().setPos(pos);
-    node.nodeGraphicsObject().moveConnections();
+void FlowScene::resetProfiles() {
+    for (Node &node : _nodes) node.resetProfile();
+
+    if (_profiler) _profiler->reset();
+
+    if (_profileOverlayVisible) update();
 }
 
-QSizeF FlowScene::getNodeSize(const Node &node) const {
-    return QSizeF(node.nodeGeometry().width(), node.nodeGeometry().height());
+std::vector<Node *> FlowScene::hottestNodes(std::size_t count) const {
+    std::vector<Node *> result = allNodes();
+
+    auto hotter = [](Node const *a, Node const *b) {
+        return a->profile().totalNanoseconds > b->profile().totalNanoseconds;
+    };
+
+    count = std::min(count, result.size());
+
+    std::partial_sort(result.begin(), result.begin() + count, result.end(),
+                      hotter);
+
+    result.resize(count);
+
+    return result;
+}
+
+qint64 FlowScene::hottestComputeTime() const {
+    return _profiler ? _profiler->hottestNanoseconds() : 0;
+}
+
+void FlowScene::setProfileOverlayVisible(bool visible) {
+    _profileOverlayVisible = visible;
+
+    update();
 }
 
-std::unordered_map<QUuid, std::unique_ptr<Node>> const &FlowScene::nodes()
-    const {
-    return _nodes;
+bool FlowScene::isProfileOverlayVisible() const {
+    return _profileOverlayVisible;
 }
 
-std::unordered_map<QUuid, std::shared_ptr<Connection>> const &
-FlowScene::connections() const {
+void FlowScene::executeParallel(unsigned int threadCount) {
+    // 先把延迟模式中积压的传播处理掉, 以免之后覆盖执行器算出的结果
+    _scheduler->flush();
+
+    if (!_executor || (threadCount != 0 &&
+                       _executor->threadCount() != threadCount)) {
+        _executor = detail::make_unique<ParallelExecutor>(threadCount);
+    }
+
+    _executor->run(_topologicalOrder->nodes());
+}
+
+FlowScene::NodeStorage const &FlowScene::nodes() const { return _nodes; }
+
+FlowScene::ConnectionStorage const &FlowScene::connections() const {
     return _connections;
 }
 
 std::vector<Node *> FlowScene::allNodes() const {
     std::vector<Node *> nodes;
+    nodes.reserve(_nodes.size());
 
-    std::transform(_nodes.begin(), _nodes.end(), std::back_inserter(nodes),
-                   [](std::pair<QUuid const, std::unique_ptr<Node>> const &p) {
-                       return p.second.get();
-                   });
+    for (Node const &node : _nodes) nodes.push_back(const_cast<Node *>(&node));
 
     return nodes;
 }
@@ -334,6 +643,16 @@ std::vector<Node *> FlowScene::selectedNodes() const {
     return ret;
 }
 
+std::vector<QGraphicsItem *> FlowScene::indexedItems(
+    QRectF const &area) const {
+    return _spatialIndex->items(area);
+}
+
+std::vector<QGraphicsItem *> FlowScene::indexedItems(
+    QPointF const &scenePoint) const {
+    return _spatialIndex->items(scenePoint);
+}
+
 //------------------------------------------------------------------------------
 
 void FlowScene::clearScene() {
@@ -341,68 +660,83 @@ void FlowScene::clearScene() {
     // work, the code crashes when
     // there are both nodes and connections in the scene. (The data propagation
     // internal logic tries to transmit data through already freed connections.)
-    while (!_connections.empty()) {
-        deleteConnection(*_connections.begin()->second);
-    }
+    std::vector<Node *> nodes;
+    nodes.reserve(_nodes.size());
+
+    for (Node &node : _nodes) nodes.push_back(&node);
 
-    while (!_nodes.empty()) {
-        removeNode(*_nodes.begin()->second);
+    removeNodes(nodes);
+
+    // 正在拖拽的连接可能只连着一个节点, 已经随节点删除;
+    // 这里只剩下没有连接任何节点的连接
+    while (!_connections.empty()) {
+        deleteConnection(**_connections.begin());
     }
 }
 
 void FlowScene::save() const {
     QString fileName = QFileDialog::getSaveFileName(
         nullptr, tr("Open Flow Scene"), QDir::homePath(),
-        tr("Flow Scene Files (*.flow)"));
+        tr("Flow Scene Files (*.flow);;Binary Flow Scene Files (*.flowb)"));
 
     if (!fileName.isEmpty()) {
-        if (!fileName.endsWith("flow", Qt::CaseInsensitive))
+        bool const binary = fileName.endsWith("flowb", Qt::CaseInsensitive);
+
+        if (!binary && !fileName.endsWith("flow", Qt::CaseInsensitive))
             fileName += ".flow";
 
         QFile file(fileName);
         if (file.open(QIODevice::WriteOnly)) {
-            file.write(saveToMemory());
+            file.write(saveToMemory(binary ? SceneFormat::Binary
+                                           : SceneFormat::Json));
         }
     }
 }
 
 void FlowScene::load() {
+    // 上一个文件可能还在加载, 不停下来的话会继续往清空后的场景里创建节点
+    if (_loader) _loader->cancel();
+
     clearScene();
 
     //-------------
 
     QString fileName = QFileDialog::getOpenFileName(
         nullptr, tr("Open Flow Scene"), QDir::homePath(),
-        tr("Flow Scene Files (*.flow)"));
+        tr("Flow Scene Files (*.flow *.flowb)"));
 
     if (!QFileInfo::exists(fileName)) return;
 
-    QFile file(fileName);
+    // 在工作线程中解析, 再分批创建节点和连接, 加载大文件时界面不会卡住
+    if (!_loader) {
+        _loader = new SceneLoader(*this);
 
-    if (!file.open(QIODevice::ReadOnly)) return;
-
-    QByteArray wholeFile = file.readAll();
+        connect(_loader, &SceneLoader::finished, this,
+                [this](SceneLoader::Result result) {
+                    if (result == SceneLoader::Result::Failed)
+                        qWarning() << "Cannot load the scene:"
+                                   << _loader->errorString();
+                });
+    }
 
-    loadFromMemory(wholeFile);
+    _loader->load(fileName);
 }
 
-QByteArray FlowScene::saveToMemory() const {
+QByteArray FlowScene::saveToMemory(SceneFormat format) const {
+    if (format == SceneFormat::Binary) return writeBinaryScene(sceneData());
+
     QJsonObject sceneJson;
 
     QJsonArray nodesJsonArray;
 
-    for (auto const &pair : _nodes) {
-        auto const &node = pair.second;
-
-        nodesJsonArray.append(node->serialize());
+    for (Node const &node : _nodes) {
+        nodesJsonArray.append(node.serialize());
     }
 
     sceneJson["nodes"] = nodesJsonArray;
 
     QJsonArray connectionJsonArray;
-    for (auto const &pair : _connections) {
-        auto const &connection = pair.second;
-
+    for (auto const &connection : _connections) {
         QJsonObject connectionJson = connection->serialize();
 
         if (!connectionJson.isEmpty())
@@ -417,19 +751,115 @@ QByteArray FlowScene::saveToMemory() const {
 }
 
 void FlowScene::loadFromMemory(const QByteArray &data) {
-    QJsonObject const jsonDocument = QJsonDocument::fromJson(data).object();
+    SceneData scene;
+
+    // 模型数据在工作线程中并行地解码和预解析, 这里只剩创建对象
+    if (!readScene(data, scene, _registry.get())) {
+        qWarning() << "Cannot read the scene data";
+        return;
+    }
+
+    restoreScene(scene);
+}
+
+QByteArray FlowScene::convertScene(QByteArray const &data,
+                                   SceneFormat format) {
+    SceneData scene;
 
-    QJsonArray nodesJsonArray = jsonDocument["nodes"].toArray();
+    if (!readScene(data, scene)) return QByteArray();
 
-    for (QJsonValueRef node : nodesJsonArray) {
-        restoreNode(node.toObject());
+    return format == SceneFormat::Binary ? writeBinaryScene(scene)
+                                         : writeJsonScene(scene);
+}
+
+void FlowScene::restoreScene(SceneData const &scene) {
+    std::size_t dangling = scene.danglingConnections;
+
+    // 连接按下标引用节点, 不需要再查找 id
+    std::vector<Node *> nodes;
+    nodes.reserve(scene.nodes.size());
+
+    for (SceneNodeRecord const &record : scene.nodes)
+        nodes.push_back(&restoreNode(record));
+
+    for (SceneConnectionRecord const &record : scene.connections) {
+        // 解析时已经统计过
+        if (record.in >= nodes.size() || record.out >= nodes.size()) continue;
+
+        if (!portsInRange(record, *nodes[record.in], *nodes[record.out])) {
+            ++dangling;
+            continue;
+        }
+
+        createConnection(*nodes[record.in], record.inPort, *nodes[record.out],
+                         record.outPort, scene.converterOf(record));
     }
 
-    QJsonArray connectionJsonArray = jsonDocument["connections"].toArray();
+    reportDanglingConnections(dangling);
+}
+
+bool FlowScene::portsInRange(SceneConnectionRecord const &record,
+                             Node const &nodeIn, Node const &nodeOut) {
+    auto inRange = [](PortIndex port, std::size_t count) {
+        return port >= 0 && static_cast<std::size_t>(port) < count;
+    };
+
+    return inRange(record.inPort,
+                   nodeIn.nodeState().getEntries(PortType::In).size()) &&
+           inRange(record.outPort,
+                   nodeOut.nodeState().getEntries(PortType::Out).size());
+}
 
-    for (QJsonValueRef connection : connectionJsonArray) {
-        restoreConnection(connection.toObject());
+void FlowScene::reportDanglingConnections(std::size_t count) {
+    if (count == 0) return;
+
+    qWarning() << "Skipped" << count
+               << "connections that refer to nodes or ports that do not exist";
+}
+
+SceneData FlowScene::sceneData() const {
+    SceneData scene;
+
+    std::unordered_map<Node const *, std::size_t> indices;
+    indices.reserve(_nodes.size());
+
+    scene.nodes.reserve(_nodes.size());
+
+    for (Node const &node : _nodes) {
+        indices[&node] = scene.nodes.size();
+
+        SceneNodeRecord record;
+        record.id = node.id();
+        record.modelName = node.nodeDataModel()->name();
+        record.position = node.position();
+        record.model = node.nodeDataModel()->serialize();
+
+        scene.nodes.push_back(std::move(record));
     }
+
+    scene.connections.reserve(_connections.size());
+
+    SceneConverterTable converters(scene);
+
+    for (auto const &connection : _connections) {
+        if (!connection->complete()) continue;
+
+        SceneConnectionRecord record;
+        record.in = indices.at(connection->getNode(PortType::In));
+        record.inPort = connection->getPortIndex(PortType::In);
+        record.out = indices.at(connection->getNode(PortType::Out));
+        record.outPort = connection->getPortIndex(PortType::Out);
+
+        if (connection->hasTypeConverter()) {
+            record.converter =
+                converters.add(connection->dataType(PortType::In),
+                               connection->dataType(PortType::Out));
+        }
+
+        scene.connections.push_back(record);
+    }
+
+    return scene;
 }
 
 void FlowScene::setupConnectionSignals(Connection const &c) const {
@@ -437,6 +867,17 @@ void FlowScene::setupConnectionSignals(Connection const &c) const {
             &FlowScene::connectionDeleted, Qt::UniqueConnection);
 }
 
+void FlowScene::updateTopologicalOrder(Connection const &c) {
+    Node *from = c.getNode(PortType::Out);
+    Node *to = c.getNode(PortType::In);
+
+    Q_ASSERT(from != nullptr);
+    Q_ASSERT(to != nullptr);
+
+    if (!_topologicalOrder->addEdge(*from, *to))
+        qWarning() << "Connection creates a cycle in the flow graph";
+}
+
 void FlowScene::sendConnectionCreatedToNodes(Connection const &c) {
     Node *from = c.getNode(PortType::Out);
     Node *to = c.getNode(PortType::In);
@@ -464,29 +905,20 @@ namespace QtNodes {
 
 Node *locateNodeAt(QPointF scenePoint, FlowScene &scene,
                    QTransform const &viewTransform) {
-    // items under cursor
-    QList<QGraphicsItem *> items =
-        scene.items(scenePoint, Qt::IntersectsItemShape, Qt::DescendingOrder,
-                    viewTransform);
-
-    //// items convertable to NodeGraphicsObject
-    std::vector<QGraphicsItem *> filteredItems;
+    // 节点都不忽略视图变换, 用不到视图的变换
+    Q_UNUSED(viewTransform);
 
-    std::copy_if(
-        items.begin(), items.end(), std::back_inserter(filteredItems),
-        [](QGraphicsItem *item) {
-            return (dynamic_cast<NodeGraphicsObject *>(item) != nullptr);
-        });
+    NodeGraphicsObject *topmost = nullptr;
 
-    Node *resultNode = nullptr;
+    for (QGraphicsItem *item : scene.indexedItems(scenePoint)) {
+        auto ngo = qgraphicsitem_cast<NodeGraphicsObject *>(item);
 
-    if (!filteredItems.empty()) {
-        QGraphicsItem *graphicsItem = filteredItems.front();
-        auto ngo = dynamic_cast<NodeGraphicsObject *>(graphicsItem);
+        if (!ngo || !ngo->contains(ngo->mapFromScene(scenePoint))) continue;
 
-        resultNode = &ngo->node();
+        // 与 QGraphicsScene::items() 的 Qt::DescendingOrder 一样取最上面的
+        if (!topmost || ngo->zValue() > topmost->zValue()) topmost = ngo;
     }
 
-    return resultNode;
+    return topmost ? &topmost->node() : nullptr;
 }
 }  // namespace QtNodes
@@ -11,6 +11,7 @@
 #include <QtWidgets>
 #include <cmath>
 #include <iostream>
+#include <vector>
 
 #include "ConnectionGraphicsObject.hpp"
 #include "DataModelRegistry.hpp"
@@ -21,6 +22,7 @@
 
 using QtNodes::FlowScene;
 using QtNodes::FlowView;
+using QtNodes::Node;
 
 FlowView::FlowView(QWidget *parent)
     : QGraphicsView(parent),
@@ -221,16 +223,21 @@ void FlowView::deleteSelectedNodes() {
     // Selected connections were already deleted prior to this loop, otherwise
     // qgraphicsitem_cast<NodeGraphicsObject*>(item) could be a use-after-free
     // when a selected connection is deleted by deleting the node.
+    std::vector<Node *> nodes;
+
     for (QGraphicsItem *item : _scene->selectedItems()) {
         if (auto n = qgraphicsitem_cast<NodeGraphicsObject *>(item))
-            _scene->removeNode(n->node());
+            nodes.push_back(&n->node());
     }
+
+    _scene->removeNodes(nodes);
 }
 
 void FlowView::keyPressEvent(QKeyEvent *event) {
     switch (event->key()) {
         case Qt::Key_Shift:
-            setDragMode(QGraphicsView::RubberBandDrag);
+            // 选择框由 mousePressEvent() 自己处理, 这里只是停止拖动视图
+            setDragMode(QGraphicsView::NoDrag);
             break;
 
         default:
@@ -256,10 +263,29 @@ void FlowView::mousePressEvent(QMouseEvent *event) {
     QGraphicsView::mousePressEvent(event);
     if (event->button() == Qt::LeftButton) {
         _clickPos = mapToScene(event->pos());
+
+        // 在空白处按下时开始框选, 场景已经清除了原来的选择
+        if ((event->modifiers() & Qt::ShiftModifier) && _scene &&
+            _scene->mouseGrabberItem() == nullptr) {
+            if (!_rubberBand) {
+                _rubberBand =
+                    new QRubberBand(QRubberBand::Rectangle, viewport());
+            }
+
+            _rubberBandOrigin = event->pos();
+            _rubberBand->setGeometry(QRect(_rubberBandOrigin, QSize()));
+            _rubberBand->show();
+        }
     }
 }
 
 void FlowView::mouseMoveEvent(QMouseEvent *event) {
+    if (_rubberBand && _rubberBand->isVisible()) {
+        updateRubberBandSelection(event->pos());
+        event->accept();
+        return;
+    }
+
     QGraphicsView::mouseMoveEvent(event);
     if (scene()->mouseGrabberItem() == nullptr &&
         event->buttons() == Qt::LeftButton) {
@@ -272,6 +298,50 @@ void FlowView::mouseMoveEvent(QMouseEvent *event) {
     }
 }
 
+void FlowView::mouseReleaseEvent(QMouseEvent *event) {
+    if (_rubberBand && _rubberBand->isVisible() &&
+        event->button() == Qt::LeftButton) {
+        updateRubberBandSelection(event->pos());
+        _rubberBand->hide();
+        event->accept();
+        return;
+    }
+
+    QGraphicsView::mouseReleaseEvent(event);
+}
+
+void FlowView::updateRubberBandSelection(QPoint const &viewPos) {
+    QRect const viewRect = QRect(_rubberBandOrigin, viewPos).normalized();
+
+    _rubberBand->setGeometry(viewRect);
+
+    // 与 QGraphicsView 默认的 Qt::IntersectsItemShape 一样, 碰到就选中
+    QPainterPath area;
+    area.addPolygon(mapToScene(viewRect));
+    area.closeSubpath();
+
+    QRectF const sceneRect = area.boundingRect();
+
+    QSet<QGraphicsItem *> inside;
+
+    for (QGraphicsItem *item : _scene->indexedItems(sceneRect)) {
+        if (!(item->flags() & QGraphicsItem::ItemIsSelectable)) continue;
+
+        // 包围盒完全在框内时不必再检查形状
+        if (sceneRect.contains(item->sceneBoundingRect()) ||
+            item->collidesWithPath(item->mapFromScene(area),
+                                   Qt::IntersectsItemShape))
+            inside.insert(item);
+    }
+
+    // selectedItems() 只遍历已选中的图元
+    for (QGraphicsItem *item : _scene->selectedItems()) {
+        if (!inside.contains(item)) item->setSelected(false);
+    }
+
+    for (QGraphicsItem *item : inside) item->setSelected(true);
+}
+
 void FlowView::drawBackground(QPainter *painter, const QRectF &r) {
     QGraphicsView::drawBackground(painter, r);
 
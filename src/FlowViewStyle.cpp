@@ -58,6 +58,23 @@ void FlowViewStyle::setStyle(QString jsonText) {
         }                                                                      \
     }
 
+#define FLOW_VIEW_STYLE_READ_FLOAT(values, variable, defaultValue) \
+    {                                                               \
+        auto valueRef = values[#variable];                          \
+        FLOW_VIEW_STYLE_CHECK_UNDEFINED_VALUE(valueRef, variable)   \
+        variable = valueRef.toDouble(defaultValue);                 \
+    }
+
+FlowViewStyle::DetailLevel FlowViewStyle::detailLevel(double scale) const {
+    if (scale < DotDetailScale) return DetailLevel::Dot;
+
+    if (scale < FlatDetailScale) return DetailLevel::Flat;
+
+    if (scale < NoTextDetailScale) return DetailLevel::NoText;
+
+    return DetailLevel::Full;
+}
+
 void FlowViewStyle::loadJsonFile(QString styleFile) {
     QFile file(styleFile);
 
@@ -86,4 +103,9 @@ void FlowViewStyle::loadJsonFromByteArray(QByteArray const &byteArray) {
     FLOW_VIEW_STYLE_READ_COLOR(obj, BackgroundColor);
     FLOW_VIEW_STYLE_READ_COLOR(obj, FineGridColor);
     FLOW_VIEW_STYLE_READ_COLOR(obj, CoarseGridColor);
+
+    // 旧的样式文件中没有这几项
+    FLOW_VIEW_STYLE_READ_FLOAT(obj, NoTextDetailScale, 0.5);
+    FLOW_VIEW_STYLE_READ_FLOAT(obj, FlatDetailScale, 0.3);
+    FLOW_VIEW_STYLE_READ_FLOAT(obj, DotDetailScale, 0.12);
 }
@@ -1,25 +1,30 @@
 #include "Node.hpp"
 
+#include <QtCore/QHash>
 #include <utility>
 
 #include "ConnectionGraphicsObject.hpp"
 #include "ConnectionState.hpp"
+#include "DataFlowScheduler.hpp"
 #include "FlowScene.hpp"
 #include "NodeDataModel.hpp"
 #include "NodeGraphicsObject.hpp"
+#include "NodeProfiler.hpp"
 
+using QtNodes::DataModelRegistry;
 using QtNodes::Node;
 using QtNodes::NodeData;
 using QtNodes::NodeDataModel;
 using QtNodes::NodeDataType;
 using QtNodes::NodeGeometry;
 using QtNodes::NodeGraphicsObject;
+using QtNodes::NodeProfiler;
 using QtNodes::NodeState;
 using QtNodes::PortIndex;
 using QtNodes::PortType;
 
 Node::Node(std::unique_ptr<NodeDataModel> &&dataModel)
-    : _uid(QUuid::createUuid()),
+    : _entityId(QtNodes::nextEntityId()),
       _nodeDataModel(std::move(dataModel)),
       _nodeState(_nodeDataModel),
       _nodeGeometry(_nodeDataModel),
@@ -39,33 +44,65 @@ Node::~Node() = default;
 QJsonObject Node::serialize() const {
     QJsonObject nodeJson;
 
-    nodeJson["id"] = _uid.toString();
+    nodeJson["id"] = id().toString();
 
     nodeJson["model"] = _nodeDataModel->serialize();
 
+    QPointF const pos = position();
+
     QJsonObject obj;
-    obj["x"] = _nodeGraphicsObject->pos().x();
-    obj["y"] = _nodeGraphicsObject->pos().y();
+    obj["x"] = pos.x();
+    obj["y"] = pos.y();
     nodeJson["position"] = obj;
 
     return nodeJson;
 }
 
 void Node::unserialize(QJsonObject const &json) {
-    _uid = QUuid(json["id"].toString());
-
     QJsonObject positionJson = json["position"].toObject();
     QPointF point(positionJson["x"].toDouble(), positionJson["y"].toDouble());
-    _nodeGraphicsObject->setPos(point);
 
-    _nodeDataModel->unserialize(json["model"].toObject());
+    unserialize(QUuid(json["id"].toString()), point,
+                json["model"].toObject());
+}
+
+void Node::unserialize(QUuid const &id, QPointF const &position,
+                       QJsonObject const &modelJson, std::any const &payload) {
+    QUuid const oldId = _uid;
+
+    _uid = id;
+
+    if (_idChanged && _uid != oldId) _idChanged(*this, oldId);
+
+    setPosition(position);
+
+    _nodeDataModel->restore(modelJson, payload);
 }
 
-QUuid Node::id() const { return _uid; }
+QUuid Node::id() const {
+    // QUuid::createUuid() 要读系统的随机数, 只在真正需要时才调用
+    if (_uid.isNull()) {
+        _uid = QUuid::createUuid();
+
+        if (_idChanged) _idChanged(*this, QUuid());
+    }
+
+    return _uid;
+}
+
+void Node::setIdChangedCallback(IdChangedCallback callback) {
+    _idChanged = std::move(callback);
+}
+
+bool Node::hasId() const { return !_uid.isNull(); }
 
 void Node::reactToPossibleConnection(PortType reactingPortType,
                                      NodeDataType const &reactingDataType,
-                                     QPointF const &scenePoint) {
+                                     QPointF const &scenePoint,
+                                     Node const *reactingNode,
+                                     DataModelRegistry::TypeId reactingTypeId) {
+    if (!_nodeGraphicsObject) return;
+
     QTransform const t = _nodeGraphicsObject->sceneTransform();
 
     QPointF p = t.inverted().map(scenePoint);
@@ -75,14 +112,32 @@ void Node::reactToPossibleConnection(PortType reactingPortType,
     _nodeGraphicsObject->update();
 
     _nodeState.setReaction(NodeState::REACTING, reactingPortType,
-                           reactingDataType);
+                           reactingDataType, reactingNode, reactingTypeId);
 }
 
 void Node::resetReactionToConnection() {
     _nodeState.setReaction(NodeState::NOT_REACTING);
-    _nodeGraphicsObject->update();
+
+    if (_nodeGraphicsObject) _nodeGraphicsObject->update();
 }
 
+QPointF Node::position() const {
+    if (_nodeGraphicsObject) return _nodeGraphicsObject->pos();
+
+    return _position;
+}
+
+void Node::setPosition(QPointF const &pos) {
+    if (_nodeGraphicsObject) {
+        _nodeGraphicsObject->setPos(pos);
+        _nodeGraphicsObject->moveConnections();
+    } else {
+        _position = pos;
+    }
+}
+
+bool Node::hasGraphicsObject() const { return _nodeGraphicsObject != nullptr; }
+
 const NodeGraphicsObject &Node::nodeGraphicsObject() const {
     return *_nodeGraphicsObject;
 }
@@ -92,7 +147,11 @@ NodeGraphicsObject &Node::nodeGraphicsObject() { return *_nodeGraphicsObject; }
 void Node::setGraphicsObject(std::unique_ptr<NodeGraphicsObject> &&graphics) {
     _nodeGraphicsObject = std::move(graphics);
 
+    if (_nodeGraphicsObject) _nodeGraphicsObject->setPos(_position);
+
     _nodeGeometry.recalculateSize();
+
+    if (_nodeGraphicsObject) _nodeGraphicsObject->updateSpatialIndex();
 }
 
 NodeGeometry &Node::nodeGeometry() { return _nodeGeometry; }
@@ -105,39 +164,149 @@ NodeState &Node::nodeState() { return _nodeState; }
 
 NodeDataModel *Node::nodeDataModel() const { return _nodeDataModel.get(); }
 
+DataModelRegistry::TypeId Node::portTypeId(DataModelRegistry const &registry,
+                                           PortType portType,
+                                           PortIndex portIndex) const {
+    // 登记的类型只增不减, 数量变了说明之前没有 id 的类型可能有了
+    if (registry.typeCount() != _portTypeCount) {
+        invalidatePortTypeIds();
+        _portTypeCount = registry.typeCount();
+    }
+
+    auto &ids = (portType == PortType::In) ? _inPortTypeIds : _outPortTypeIds;
+    auto const port = static_cast<std::size_t>(portIndex);
+
+    if (port >= ids.size()) ids.resize(port + 1);
+
+    if (!ids[port]) {
+        ids[port] =
+            registry.typeId(_nodeDataModel->dataType(portType, portIndex));
+    }
+
+    return *ids[port];
+}
+
+void Node::invalidatePortTypeIds() const {
+    _inPortTypeIds.clear();
+    _outPortTypeIds.clear();
+}
+
+void Node::setScheduler(DataFlowScheduler *scheduler) {
+    _scheduler = scheduler;
+}
+
+void Node::setProfiler(NodeProfiler *profiler) { _profiler = profiler; }
+
+void Node::resetProfile() { _profile = NodeProfile(); }
+
+void Node::propagateData(PortIndex index) const {
+    auto nodeData = _nodeDataModel->outData(index);
+
+    auto const &connections = _nodeState.connections(PortType::Out, index);
+
+    if (_profiler)
+        _profiler->recordOutput(_profile, nodeData, connections.size());
+
+    for (Connection *c : connections) c->transmitData(nodeData);
+}
+
 void Node::transmitData(std::shared_ptr<NodeData> nodeData,
                         PortIndex inPortIndex) const {
+    if (!inputChanged(nodeData, inPortIndex)) return;
+
+    // 节点自己的几何更新也计入它的时间, 同步触发的下游计算则不计入
+    NodeProfiler::Scope scope(_profiler, _profile);
+
     _nodeDataModel->setInData(std::move(nodeData), inPortIndex);
 
+    updateGraphics();
+}
+
+bool Node::inputChanged(std::shared_ptr<NodeData> const &nodeData,
+                        PortIndex inPortIndex) const {
+    if (!_nodeDataModel->memoizeInputs() || inPortIndex < 0) return true;
+
+    auto const port = static_cast<std::size_t>(inPortIndex);
+
+    if (port >= _inputs.size()) _inputs.resize(port + 1);
+
+    std::optional<std::size_t> hash;
+
+    if (nodeData) {
+        if (auto valueHash = nodeData->hash()) {
+            // 不同类型的数据即使值的哈希相同也不能算作同一个输入
+            hash = qHash(nodeData->type().id) ^
+                   (*valueHash + 0x9e3779b9 + (*valueHash << 6));
+        }
+    }
+
+    MemoizedInput &last = _inputs[port];
+
+    // 哈希只用来快速发现不同, 相同时还要比较值本身
+    if (hash && last.hash == hash &&
+        (last.data == nodeData || (last.data->sameType(*nodeData) &&
+                                   last.data->equals(*nodeData)))) {
+        ++_memoHits;
+        return false;
+    }
+
+    last.hash = hash;
+    last.data = hash ? nodeData : nullptr;
+    ++_memoMisses;
+
+    return true;
+}
+
+void Node::resetMemo() {
+    _inputs.clear();
+    _memoHits = 0;
+    _memoMisses = 0;
+}
+
+void Node::updateGraphics() const {
+    // headless 场景中没有需要重绘的东西
+    if (!_nodeGraphicsObject) return;
+
     // 重新计算节点的视觉效果.
     // 数据更改可能导致节点占用比以前更多的空间,
     // 因为这会在受影响的节点上强制进行重新计算 + 重新绘制.
     // TODO: 想办法修一下这里的内存泄露 (修不了就算了, 谁会差那几十KB内存啊)
     _nodeGraphicsObject->setGeometryChanged();
+    _nodeGeometry.invalidate(NodeGeometry::DataDirty |
+                             NodeGeometry::ValidationDirty);
+    invalidatePortTypeIds();
     _nodeGeometry.recalculateSize();
     _nodeGraphicsObject->update();
+    _nodeGraphicsObject->updateSpatialIndex();
     _nodeGraphicsObject->moveConnections();
 }
 
 void Node::onDataUpdated(PortIndex index) {
-    auto nodeData = _nodeDataModel->outData(index);
-
-    auto connections = _nodeState.connections(PortType::Out, index);
+    if (_scheduler && _scheduler->deferred()) {
+        _scheduler->markDirty(*this, index);
+        return;
+    }
 
-    for (auto const &c : connections) c.second->transmitData(nodeData);
+    propagateData(index);
 }
 
 void Node::onNodeSizeUpdated() {
     if (nodeDataModel()->embeddedWidget()) {
         nodeDataModel()->embeddedWidget()->adjustSize();
     }
+    // 模型可能在 widget 中改了标题或者验证消息, 没有经过输入更新
+    nodeGeometry().invalidate(NodeGeometry::DataDirty |
+                              NodeGeometry::ValidationDirty);
     nodeGeometry().recalculateSize();
+
+    if (!_nodeGraphicsObject) return;
+
+    _nodeGraphicsObject->updateSpatialIndex();
+
     for (PortType type : {PortType::In, PortType::Out}) {
-        for (auto &conn_set : nodeState().getEntries(type)) {
-            for (auto &pair : conn_set) {
-                Connection *conn = pair.second;
+        for (auto const &connections : nodeState().getEntries(type)) {
+            for (Connection *conn : connections)
                 conn->getConnectionGraphicsObject().move();
-            }
         }
     }
 }
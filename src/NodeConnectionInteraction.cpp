@@ -7,6 +7,7 @@
 #include "NodeGraphicsObject.hpp"
 
 using QtNodes::Connection;
+using QtNodes::DataModelRegistry;
 using QtNodes::FlowScene;
 using QtNodes::Node;
 using QtNodes::NodeConnectionInteraction;
@@ -35,6 +36,15 @@ bool NodeConnectionInteraction::canConnect(PortIndex &portIndex,
 
     if (node == _node) return false;
 
+    // 1.6) Forbid closing a cycle in the data flow graph
+    if (node) {
+        bool const closesCycle = (requiredPort == PortType::In)
+                                     ? _scene->wouldCreateCycle(*node, *_node)
+                                     : _scene->wouldCreateCycle(*_node, *node);
+
+        if (closesCycle) return false;
+    }
+
     // 2) connection point is on top of the node port
 
     QPointF connectionPoint = connectionEndScenePosition(requiredPort);
@@ -53,22 +63,39 @@ bool NodeConnectionInteraction::canConnect(PortIndex &portIndex,
     // 4) Connection type equals node port type, or there is a registered type
     // conversion that can translate between the two
 
-    auto connectionDataType = _connection->dataType(oppositePort(requiredPort));
+    auto const &registry = _scene->registry();
+
+    // 两端的类型 id 都缓存在节点中, 连接的类型就是 node 上那个端口的类型
+    PortType const attachedPort = oppositePort(requiredPort);
 
-    auto const &modelTarget = _node->nodeDataModel();
-    NodeDataType candidateNodeDataType =
-        modelTarget->dataType(requiredPort, portIndex);
+    auto const connectionTypeId =
+        node ? node->portTypeId(registry, attachedPort,
+                                _connection->getPortIndex(attachedPort))
+             : DataModelRegistry::InvalidTypeId;
+    auto const candidateTypeId =
+        _node->portTypeId(registry, requiredPort, portIndex);
+
+    // 没有注册过的类型只能按名字比较
+    if (connectionTypeId == DataModelRegistry::InvalidTypeId ||
+        candidateTypeId == DataModelRegistry::InvalidTypeId) {
+        return _connection->dataType(attachedPort).id ==
+               _node->nodeDataModel()->dataType(requiredPort, portIndex).id;
+    }
+
+    if (connectionTypeId != candidateTypeId) {
+        TypeConverter const *found = nullptr;
 
-    if (connectionDataType.id != candidateNodeDataType.id) {
         if (requiredPort == PortType::In) {
-            converter = _scene->registry().getTypeConverter(
-                connectionDataType, candidateNodeDataType);
+            found =
+                registry.findTypeConverter(connectionTypeId, candidateTypeId);
         } else if (requiredPort == PortType::Out) {
-            converter = _scene->registry().getTypeConverter(
-                candidateNodeDataType, connectionDataType);
+            found =
+                registry.findTypeConverter(candidateTypeId, connectionTypeId);
         }
 
-        return (converter != nullptr);
+        if (found) converter = *found;
+
+        return (found != nullptr);
     }
 
     return true;
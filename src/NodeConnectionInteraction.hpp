@@ -21,6 +21,8 @@ class NodeConnectionInteraction {
 
     /// 节点之间能够连接的条件:
     /// 1) Connection对象 调用required()函数 '请求了' 端口
+    /// 1.5) 不是把节点连接到它自身
+    /// 1.6) 连接不会在数据流图中形成环
     /// 2) Connection对象的端点覆盖住了node的端口
     /// 3) Node port 是空的
     /// 4) Connection的数据类型和Port的数据类型保持一致,
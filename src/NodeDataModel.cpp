@@ -1,9 +1,13 @@
 #include "NodeDataModel.hpp"
 
+#include "BackgroundTask.hpp"
 #include "StyleCollection.hpp"
 
 using QtNodes::NodeDataModel;
 using QtNodes::NodeStyle;
+using QtNodes::PortIndex;
+using QtNodes::PortType;
+using QtNodes::runInBackground;
 
 NodeDataModel::NodeDataModel() : _nodeStyle(StyleCollection::nodeStyle()) {
     // Derived classes can initialize specific style here
@@ -20,3 +24,31 @@ QJsonObject NodeDataModel::serialize() const {
 NodeStyle const &NodeDataModel::nodeStyle() const { return _nodeStyle; }
 
 void NodeDataModel::setNodeStyle(NodeStyle const &style) { _nodeStyle = style; }
+
+void NodeDataModel::computeAsync(std::function<AsyncResult()> work) {
+    quint64 const generation = ++_computeGeneration;
+
+    if (_pendingComputations++ == 0) Q_EMIT computingStarted();
+
+    runInBackground(this, std::move(work),
+                    [generation](NodeDataModel &model,
+                                 AsyncResult const &result) {
+                        model.finishComputation(generation, result);
+                    });
+}
+
+void NodeDataModel::finishComputation(quint64 generation,
+                                      AsyncResult const &result) {
+    --_pendingComputations;
+
+    bool const latest = (generation == _computeGeneration);
+
+    if (latest && result) result();
+
+    if (_pendingComputations == 0) Q_EMIT computingFinished();
+
+    if (latest) {
+        for (unsigned int i = 0; i < nPorts(PortType::Out); ++i)
+            Q_EMIT dataUpdated(PortIndex(i));
+    }
+}
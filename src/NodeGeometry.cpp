@@ -28,13 +28,8 @@ NodeGeometry::NodeGeometry(std::unique_ptr<NodeDataModel> const &dataModel)
       _nSinks(dataModel->nPorts(PortType::In)),
       _draggingPos(-1000, -1000),
       _dataModel(dataModel),
-      _fontMetrics(QFont()),
-      _boldFontMetrics(QFont()) {
-    QFont f;
-    f.setBold(true);
-
-    _boldFontMetrics = QFontMetrics(f);
-}
+      _fontMetrics(_font),
+      _boldFontMetrics(_font) {}
 
 unsigned int NodeGeometry::nSources() const {
     return _dataModel->nPorts(PortType::Out);
@@ -61,7 +56,8 @@ QRectF NodeGeometry::boundingRect() const {
 }
 
 void NodeGeometry::recalculateSize() const {
-    _entryHeight = _fontMetrics.height();
+    updateMeasurements();
+
     {
         unsigned int maxNumOfEntries = std::max(_nSinks, _nSources);
         unsigned int step = _entryHeight + _spacing;
@@ -70,10 +66,7 @@ void NodeGeometry::recalculateSize() const {
     if (auto w = _dataModel->embeddedWidget()) {
         _height = std::max(_height, static_cast<unsigned>(w->height()));
     }
-    _height += captionHeight();
-
-    _inputPortWidth = portWidth(PortType::In);
-    _outputPortWidth = portWidth(PortType::Out);
+    _height += _captionHeight;
 
     _width = _inputPortWidth + _outputPortWidth + 2 * _spacing;
 
@@ -81,28 +74,76 @@ void NodeGeometry::recalculateSize() const {
         _width += w->width();
     }
 
-    _width = std::max(_width, captionWidth());
+    _width = std::max(_width, _captionWidth);
 
     if (_dataModel->validationState() != NodeValidationState::Valid) {
-        _width = std::max(_width, validationWidth());
-        _height += validationHeight() + _spacing;
+        _width = std::max(_width, _validationWidth);
+        _height += _validationHeight + _spacing;
     }
 }
 
 void NodeGeometry::recalculateSize(QFont const &font) const {
-    QFontMetrics fontMetrics(font);
-    QFont boldFont = font;
+    // 比较字体很便宜, 不需要每次绘制都构造 QFontMetrics
+    if (font == _font) return;
+
+    _font = font;
+
+    invalidate(FontDirty);
+    recalculateSize();
+}
+
+void NodeGeometry::updateMeasurements() const {
+    unsigned int const nSources = _dataModel->nPorts(PortType::Out);
+    unsigned int const nSinks = _dataModel->nPorts(PortType::In);
+
+    if (nSources != _nSources || nSinks != _nSinks) {
+        _nSources = nSources;
+        _nSinks = nSinks;
+        _dirty |= PortCountDirty;
+    }
+
+    if (!_dirty) return;
 
-    boldFont.setBold(true);
+    if (_dirty & FontDirty) {
+        QFont boldFont = _font;
+        boldFont.setBold(true);
 
-    QFontMetrics boldFontMetrics(boldFont);
+        _fontMetrics = QFontMetrics(_font);
+        _boldFontMetrics = QFontMetrics(boldFont);
 
-    if (_boldFontMetrics != boldFontMetrics) {
-        _fontMetrics = fontMetrics;
-        _boldFontMetrics = boldFontMetrics;
+        _entryHeight = _fontMetrics.height();
+    }
 
-        recalculateSize();
+    if (_dirty & (FontDirty | DataDirty | PortCountDirty)) {
+        _inputPortWidth = measurePorts(PortType::In);
+        _outputPortWidth = measurePorts(PortType::Out);
     }
+
+    if (_dirty & (FontDirty | DataDirty)) {
+        if (_dataModel->captionVisible()) {
+            QRect const rect =
+                _boldFontMetrics.boundingRect(_dataModel->caption());
+
+            _captionWidth = rect.width();
+            _captionHeight = rect.height();
+        } else {
+            _captionWidth = 0;
+            _captionHeight = 0;
+        }
+    }
+
+    if (_dirty & (FontDirty | DataDirty | ValidationDirty)) {
+        QRect const rect =
+            _boldFontMetrics.boundingRect(_dataModel->validationMessage());
+
+        _validationWidth = rect.width();
+        _validationHeight = rect.height();
+
+        _validationTextWidth =
+            _fontMetrics.boundingRect(_dataModel->validationMessage()).width();
+    }
+
+    _dirty = 0;
 }
 
 QPointF NodeGeometry::portScenePosition(PortIndex index, PortType portType,
@@ -115,7 +156,7 @@ QPointF NodeGeometry::portScenePosition(PortIndex index, PortType portType,
 
     double totalHeight = 0.0;
 
-    totalHeight += captionHeight();
+    totalHeight += _captionHeight;
 
     totalHeight += step * index;
 
@@ -184,17 +225,17 @@ QPointF NodeGeometry::widgetPosition() const {
         if (w->sizePolicy().verticalPolicy() & QSizePolicy::ExpandFlag) {
             // If the widget wants to use as much vertical space as possible,
             // place it immediately after the caption.
-            return QPointF(_spacing + portWidth(PortType::In), captionHeight());
+            return QPointF(_spacing + _inputPortWidth, _captionHeight);
         } else {
             if (_dataModel->validationState() != NodeValidationState::Valid) {
-                return QPointF(_spacing + portWidth(PortType::In),
-                               (captionHeight() + _height - validationHeight() -
+                return QPointF(_spacing + _inputPortWidth,
+                               (_captionHeight + _height - _validationHeight -
                                 _spacing - w->height()) /
                                    2.0);
             }
 
-            return QPointF(_spacing + portWidth(PortType::In),
-                           (captionHeight() + _height - w->height()) / 2.0);
+            return QPointF(_spacing + _inputPortWidth,
+                           (_captionHeight + _height - w->height()) / 2.0);
         }
     }
     return QPointF();
@@ -202,38 +243,19 @@ QPointF NodeGeometry::widgetPosition() const {
 
 int NodeGeometry::equivalentWidgetHeight() const {
     if (_dataModel->validationState() != NodeValidationState::Valid) {
-        return height() - captionHeight() + validationHeight();
+        return height() - _captionHeight + _validationHeight;
     }
 
-    return height() - captionHeight();
+    return height() - _captionHeight;
 }
 
-unsigned int NodeGeometry::captionHeight() const {
-    if (!_dataModel->captionVisible()) return 0;
-
-    QString name = _dataModel->caption();
-
-    return _boldFontMetrics.boundingRect(name).height();
-}
-
-unsigned int NodeGeometry::captionWidth() const {
-    if (!_dataModel->captionVisible()) return 0;
-
-    QString name = _dataModel->caption();
+unsigned int NodeGeometry::portLabelWidth(PortIndex index,
+                                          PortType portType) const {
+    auto const &widths =
+        (portType == PortType::In) ? _inLabelWidths : _outLabelWidths;
 
-    return _boldFontMetrics.boundingRect(name).width();
-}
-
-unsigned int NodeGeometry::validationHeight() const {
-    QString msg = _dataModel->validationMessage();
-
-    return _boldFontMetrics.boundingRect(msg).height();
-}
-
-unsigned int NodeGeometry::validationWidth() const {
-    QString msg = _dataModel->validationMessage();
-
-    return _boldFontMetrics.boundingRect(msg).width();
+    return (index >= 0 && std::size_t(index) < widths.size()) ? widths[index]
+                                                              : 0;
 }
 
 QPointF NodeGeometry::calculateNodePositionBetweenNodePorts(
@@ -246,10 +268,10 @@ QPointF NodeGeometry::calculateNodePositionBetweenNodePorts(
     // for both nodes averaged). The second line offsets this coordinate with the
     // size of the new node, so that the new nodes center falls on the originally
     // calculated coordinate, instead of it's upper left corner.
-    auto converterNodePos = (sourceNode->nodeGraphicsObject().pos() +
+    auto converterNodePos = (sourceNode->position() +
                              sourceNode->nodeGeometry().portScenePosition(
                                  sourcePortIndex, sourcePort) +
-                             targetNode->nodeGraphicsObject().pos() +
+                             targetNode->position() +
                              targetNode->nodeGeometry().portScenePosition(
                                  targetPortIndex, targetPort)) /
                             2.0f;
@@ -260,10 +282,15 @@ QPointF NodeGeometry::calculateNodePositionBetweenNodePorts(
     return converterNodePos;
 }
 
-unsigned int NodeGeometry::portWidth(PortType portType) const {
+unsigned int NodeGeometry::measurePorts(PortType portType) const {
+    auto &widths =
+        (portType == PortType::In) ? _inLabelWidths : _outLabelWidths;
+
+    widths.assign(_dataModel->nPorts(portType), 0);
+
     unsigned width = 0;
 
-    for (auto i = 0ul; i < _dataModel->nPorts(portType); ++i) {
+    for (std::size_t i = 0; i < widths.size(); ++i) {
         QString name;
 
         if (_dataModel->portCaptionVisible(portType, i)) {
@@ -272,7 +299,8 @@ unsigned int NodeGeometry::portWidth(PortType portType) const {
             name = _dataModel->dataType(portType, i).name;
         }
 
-        width = std::max(unsigned(_fontMetrics.horizontalAdvance(name)), width);
+        widths[i] = unsigned(_fontMetrics.horizontalAdvance(name));
+        width = std::max(widths[i], width);
     }
 
     return width;
@@ -14,8 +14,33 @@
 #include "StyleCollection.hpp"
 
 using QtNodes::FlowScene;
+using QtNodes::FlowViewStyle;
 using QtNodes::Node;
 using QtNodes::NodeGraphicsObject;
+using QtNodes::StyleCollection;
+
+namespace {
+
+/// 缩小到不画文字以下时不画阴影的 QGraphicsDropShadowEffect.
+/// 阴影要把节点先画到离屏缓冲再模糊, 节点很小时比节点本身还费时.
+/// 每次绘制时按 painter 的变换判断, 所以每个视图各自决定,
+/// 之后新建的节点也一样
+class NodeShadowEffect : public QGraphicsDropShadowEffect {
+   protected:
+    void draw(QPainter *painter) override {
+        using DetailLevel = FlowViewStyle::DetailLevel;
+
+        DetailLevel const level = StyleCollection::flowViewStyle().detailLevel(
+            QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+                painter->worldTransform()));
+
+        if (level == DetailLevel::Full || level == DetailLevel::NoText)
+            QGraphicsDropShadowEffect::draw(painter);
+        else
+            drawSource(painter);
+    }
+};
+}  // namespace
 
 NodeGraphicsObject::NodeGraphicsObject(FlowScene &scene, Node &node)
     : _scene(scene), _node(node), _locked(false), _proxyWidget(nullptr) {
@@ -32,7 +57,7 @@ NodeGraphicsObject::NodeGraphicsObject(FlowScene &scene, Node &node)
     auto const &nodeStyle = node.nodeDataModel()->nodeStyle();
 
     {
-        auto effect = new QGraphicsDropShadowEffect;
+        auto effect = new NodeShadowEffect;
         effect->setOffset(4, 4);
         effect->setBlurRadius(20);
         effect->setColor(nodeStyle.ShadowColor);
@@ -52,9 +77,14 @@ NodeGraphicsObject::NodeGraphicsObject(FlowScene &scene, Node &node)
     auto onMoveSlot = [this] { _scene.nodeMoved(_node, pos()); };
     connect(this, &QGraphicsObject::xChanged, this, onMoveSlot);
     connect(this, &QGraphicsObject::yChanged, this, onMoveSlot);
+
+    updateSpatialIndex();
 }
 
-NodeGraphicsObject::~NodeGraphicsObject() { _scene.removeItem(this); }
+NodeGraphicsObject::~NodeGraphicsObject() {
+    _scene.unindexItem(*this);
+    _scene.removeItem(this);
+}
 
 Node &NodeGraphicsObject::node() { return _node; }
 
@@ -70,6 +100,8 @@ void NodeGraphicsObject::embedQWidget() {
 
         _proxyWidget->setPreferredWidth(5);
 
+        geom.invalidate(NodeGeometry::DataDirty |
+                        NodeGeometry::ValidationDirty);
         geom.recalculateSize();
 
         if (w->sizePolicy().verticalPolicy() & QSizePolicy::ExpandFlag) {
@@ -92,6 +124,8 @@ QRectF NodeGraphicsObject::boundingRect() const {
 
 void NodeGraphicsObject::setGeometryChanged() { prepareGeometryChange(); }
 
+void NodeGraphicsObject::updateSpatialIndex() { _scene.indexItem(*this); }
+
 /// 重定位连接线的位置, 访问所有连接并更正其相应的端点。
 void NodeGraphicsObject::moveConnections() const {
     NodeState const &nodeState = _node.nodeState();
@@ -100,8 +134,8 @@ void NodeGraphicsObject::moveConnections() const {
         auto const &connectionEntries = nodeState.getEntries(portType);
 
         for (auto const &connections : connectionEntries) {
-            for (auto &con : connections)
-                con.second->getConnectionGraphicsObject().move();
+            for (Connection *con : connections)
+                con->getConnectionGraphicsObject().move();
         }
     }
 }
@@ -128,6 +162,9 @@ QVariant NodeGraphicsObject::itemChange(GraphicsItemChange change,
         moveConnections();
     }
 
+    // 拖动时每一步都会更新, 节点仍在原来的格子里时只是改一下矩形
+    if (change == ItemScenePositionHasChanged) updateSpatialIndex();
+
     return QGraphicsItem::itemChange(change, value);
 }
 
@@ -149,12 +186,12 @@ void NodeGraphicsObject::mousePressEvent(QGraphicsSceneMouseEvent *event) {
         if (portIndex != INVALID) {
             NodeState const &nodeState = _node.nodeState();
 
-            std::unordered_map<QUuid, Connection *> connections =
+            auto const &connections =
                 nodeState.connections(portToCheck, portIndex);
 
             // 开始拖动已经存在的Connection对象
             if (!connections.empty() && portToCheck == PortType::In) {
-                auto con = connections.begin()->second;
+                auto con = connections.front();
 
                 NodeConnectionInteraction interaction(_node, *con, _scene);
 
@@ -167,7 +204,7 @@ void NodeGraphicsObject::mousePressEvent(QGraphicsSceneMouseEvent *event) {
                             portIndex);
                     if (!connections.empty() &&
                         outPolicy == NodeDataModel::ConnectionPolicy::One) {
-                        _scene.deleteConnection(*connections.begin()->second);
+                        _scene.deleteConnection(*connections.front());
                     }
                 }
 
@@ -213,9 +250,13 @@ void NodeGraphicsObject::mouseMoveEvent(QGraphicsSceneMouseEvent *event) {
             _proxyWidget->setMaximumSize(oldSize);
             _proxyWidget->setPos(geom.widgetPosition());
 
+            geom.invalidate(NodeGeometry::DataDirty |
+                            NodeGeometry::ValidationDirty);
             geom.recalculateSize();
             update();
 
+            updateSpatialIndex();
+
             moveConnections();
 
             event->accept();
@@ -247,10 +288,9 @@ void NodeGraphicsObject::mouseReleaseEvent(QGraphicsSceneMouseEvent *event) {
 }
 
 void NodeGraphicsObject::hoverEnterEvent(QGraphicsSceneHoverEvent *event) {
-    // 将被碰撞的节点
-    QList<QGraphicsItem *> overlapItems = collidingItems();
-
-    for (QGraphicsItem *item : overlapItems) {
+    // 将被碰撞的节点. 用空间索引按包围盒查找, 比 collidingItems() 范围大,
+    // 多找到的图元不会在前面, 不受影响
+    for (QGraphicsItem *item : _scene.indexedItems(sceneBoundingRect())) {
         if (item->zValue() > 0.0) {
             item->setZValue(0.0);
         }
@@ -1,8 +1,11 @@
 #include "NodePainter.hpp"
 
 #include <QtCore/QMargins>
+#include <QtWidgets/QStyleOptionGraphicsItem>
+#include <algorithm>
 #include <cmath>
 
+#include "DataModelRegistry.hpp"
 #include "FlowScene.hpp"
 #include "Node.hpp"
 #include "NodeDataModel.hpp"
@@ -12,12 +15,15 @@
 #include "PortType.hpp"
 #include "StyleCollection.hpp"
 
+using QtNodes::DataModelRegistry;
 using QtNodes::FlowScene;
+using QtNodes::FlowViewStyle;
 using QtNodes::Node;
 using QtNodes::NodeDataModel;
 using QtNodes::NodeGeometry;
 using QtNodes::NodeGraphicsObject;
 using QtNodes::NodePainter;
+using QtNodes::NodeProfile;
 using QtNodes::NodeState;
 
 void NodePainter::paint(QPainter *painter, Node &node, FlowScene const &scene) {
@@ -32,19 +38,44 @@ void NodePainter::paint(QPainter *painter, Node &node, FlowScene const &scene) {
     //--------------------------------------------
     NodeDataModel const *model = node.nodeDataModel();
 
+    using DetailLevel = FlowViewStyle::DetailLevel;
+
+    DetailLevel const level = StyleCollection::flowViewStyle().detailLevel(
+        QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+            painter->worldTransform()));
+
+    // 节点只有几个像素大时, 端口和文字都看不清, 不必再画
+    if (level == DetailLevel::Dot) {
+        drawNodeDot(painter, geom, model, graphicsObject);
+        return;
+    }
+
+    if (level == DetailLevel::Flat) {
+        drawFlatNodeRect(painter, geom, model, graphicsObject);
+        return;
+    }
+
+    bool const withText = (level == DetailLevel::Full);
+
     drawNodeRect(painter, geom, model, graphicsObject);
 
-    drawConnectionPoints(painter, geom, state, model, scene);
+    drawConnectionPoints(painter, geom, state, model, node, scene);
 
     drawFilledConnectionPoints(painter, geom, state, model);
 
-    drawModelName(painter, geom, state, model);
+    if (withText) {
+        drawModelName(painter, geom, state, model);
 
-    drawEntryLabels(painter, geom, state, model);
+        drawEntryLabels(painter, geom, state, model);
+    }
 
     drawResizeRect(painter, geom, model);
 
-    drawValidationRect(painter, geom, model, graphicsObject);
+    drawValidationRect(painter, geom, model, graphicsObject, withText);
+
+    drawComputingIndicator(painter, geom, state, model);
+
+    drawProfileOverlay(painter, geom, node, scene, withText);
 
     /// 调用自定义的painter
     if (auto painterDelegate = model->painterDelegate()) {
@@ -52,6 +83,42 @@ void NodePainter::paint(QPainter *painter, Node &node, FlowScene const &scene) {
     }
 }
 
+void NodePainter::drawFlatNodeRect(QPainter *painter,
+                                   NodeGeometry const &geom,
+                                   NodeDataModel const *model,
+                                   NodeGraphicsObject const &graphicsObject) {
+    NodeStyle const &nodeStyle = model->nodeStyle();
+
+    // 选中的节点仍然要能看出来, 宽度为 0 的画笔总是一个像素宽
+    if (graphicsObject.isSelected())
+        painter->setPen(QPen(nodeStyle.SelectedBoundaryColor, 0));
+    else
+        painter->setPen(Qt::NoPen);
+
+    painter->setBrush(nodeStyle.GradientColor1);
+
+    float diam = nodeStyle.ConnectionPointDiameter;
+
+    painter->drawRect(QRectF(-diam, -diam, 2.0 * diam + geom.width(),
+                             2.0 * diam + geom.height()));
+}
+
+void NodePainter::drawNodeDot(QPainter *painter, NodeGeometry const &geom,
+                              NodeDataModel const *model,
+                              NodeGraphicsObject const &graphicsObject) {
+    NodeStyle const &nodeStyle = model->nodeStyle();
+
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(graphicsObject.isSelected()
+                          ? nodeStyle.SelectedBoundaryColor
+                          : nodeStyle.GradientColor1.lighter(150));
+
+    double const radius = std::min(geom.width(), geom.height()) / 2.0;
+
+    painter->drawEllipse(QPointF(geom.width() / 2.0, geom.height() / 2.0),
+                         radius, radius);
+}
+
 void NodePainter::drawNodeRect(QPainter *painter,
                                NodeGeometry const &geom,
                                NodeDataModel const *model,
@@ -92,6 +159,7 @@ void NodePainter::drawConnectionPoints(QPainter *painter,
                                        NodeGeometry const &geom,
                                        NodeState const &state,
                                        NodeDataModel const *model,
+                                       Node const &node,
                                        FlowScene const &scene) {
     NodeStyle const &nodeStyle = model->nodeStyle();
     auto const &connectionStyle = StyleCollection::connectionStyle();
@@ -99,14 +167,29 @@ void NodePainter::drawConnectionPoints(QPainter *painter,
     float diameter = nodeStyle.ConnectionPointDiameter;
     auto reducedDiameter = diameter * 0.6;
 
+    auto const &registry = scene.registry();
+
+    // 拖动连接时每次重绘都要检查所有端口, 这里只比较缓存的整数类型id
+    DataModelRegistry::TypeId const reactingTypeId = state.reactingTypeId();
+
     for (PortType portType : {PortType::Out, PortType::In}) {
         size_t n = state.getEntries(portType).size();
 
+        // 会形成环的端口和类型不匹配的端口一样显示为不可连接.
+        // 是否成环只取决于两个节点和端口方向, 每个方向只查一次
+        bool cycle = false;
+
+        if (state.isReacting() && portType == state.reactingPortType()) {
+            if (Node const *reactingNode = state.reactingNode()) {
+                cycle = (portType == PortType::In)
+                            ? scene.wouldCreateCycle(*reactingNode, node)
+                            : scene.wouldCreateCycle(node, *reactingNode);
+            }
+        }
+
         for (unsigned int i = 0; i < n; ++i) {
             QPointF p = geom.portScenePosition(i, portType);
 
-            auto const &dataType = model->dataType(portType, i);
-
             bool canConnect = (state.getEntries(portType)[i].empty() ||
                                (portType == PortType::Out &&
                                 model->portOutConnectionPolicy(i) ==
@@ -120,19 +203,23 @@ void NodePainter::drawConnectionPoints(QPainter *painter,
                 bool typeConvertable = false;
 
                 {
-                    if (portType == PortType::In) {
+                    auto const portTypeId =
+                        node.portTypeId(registry, portType, i);
+
+                    if (reactingTypeId == DataModelRegistry::InvalidTypeId ||
+                        portTypeId == DataModelRegistry::InvalidTypeId) {
+                        typeConvertable = state.reactingDataType().id ==
+                                          model->dataType(portType, i).id;
+                    } else if (portType == PortType::In) {
                         typeConvertable =
-                            scene.registry().getTypeConverter(
-                                state.reactingDataType(), dataType) != nullptr;
+                            registry.canConvert(reactingTypeId, portTypeId);
                     } else {
                         typeConvertable =
-                            scene.registry().getTypeConverter(
-                                dataType, state.reactingDataType()) != nullptr;
+                            registry.canConvert(portTypeId, reactingTypeId);
                     }
                 }
 
-                if (state.reactingDataType().id == dataType.id ||
-                    typeConvertable) {
+                if (!cycle && typeConvertable) {
                     double const thres = 40.0;
                     r = (dist < thres) ? (2.0 - dist / thres) : 1.0;
                 } else {
@@ -142,8 +229,8 @@ void NodePainter::drawConnectionPoints(QPainter *painter,
             }
 
             if (connectionStyle.useDataDefinedColors()) {
-                painter->setBrush(
-                    QtNodes::ConnectionStyle::normalColor(dataType.id));
+                painter->setBrush(QtNodes::ConnectionStyle::normalColor(
+                    model->dataType(portType, i).id));
             } else {
                 painter->setBrush(nodeStyle.ConnectionPointColor);
             }
@@ -226,11 +313,8 @@ void NodePainter::drawModelName(QPainter *painter, NodeGeometry const &geom,
 
     f.setBold(true);
 
-    QFontMetrics metrics(f);
-
-    auto rect = metrics.boundingRect(name);
-
-    QPointF position((geom.width() - rect.width()) / 2.0,
+    // 标题的宽度在 NodeGeometry 中已经用同样的粗体测量过了
+    QPointF position((geom.width() - geom.captionWidth()) / 2.0,
                      (geom.spacing() + geom.entryHeight()) / 3.0);
 
     painter->setFont(f);
@@ -250,8 +334,6 @@ void NodePainter::drawModelName(QPainter *painter, NodeGeometry const &geom,
 void NodePainter::drawEntryLabels(QPainter *painter, NodeGeometry const &geom,
                                   NodeState const &state,
                                   NodeDataModel const *model) {
-    QFontMetrics const &metrics = painter->fontMetrics();
-
     for (PortType portType : {PortType::Out, PortType::In}) {
         auto const &nodeStyle = model->nodeStyle();
 
@@ -275,9 +357,8 @@ void NodePainter::drawEntryLabels(QPainter *painter, NodeGeometry const &geom,
                 s = model->dataType(portType, i).name;
             }
 
-            auto rect = metrics.boundingRect(s);
-
-            p.setY(p.y() + rect.height() / 4.0);
+            // 端口名的尺寸用 NodeGeometry 缓存的测量结果, 绘制时不再测量
+            p.setY(p.y() + geom.entryHeight() / 4.0);
 
             switch (portType) {
                 case PortType::In:
@@ -285,7 +366,8 @@ void NodePainter::drawEntryLabels(QPainter *painter, NodeGeometry const &geom,
                     break;
 
                 case PortType::Out:
-                    p.setX(geom.width() - 5.0 - rect.width());
+                    p.setX(geom.width() - 5.0 -
+                           geom.portLabelWidth(i, portType));
                     break;
 
                 default:
@@ -306,10 +388,68 @@ void NodePainter::drawResizeRect(QPainter *painter, NodeGeometry const &geom,
     }
 }
 
+void NodePainter::drawComputingIndicator(QPainter *painter,
+                                         NodeGeometry const &geom,
+                                         NodeState const &state,
+                                         NodeDataModel const *model) {
+    if (!state.computing()) return;
+
+    NodeStyle const &nodeStyle = model->nodeStyle();
+
+    float diam = nodeStyle.ConnectionPointDiameter;
+
+    // 标题栏右侧的小圆点表示模型正在后台计算
+    QPointF center(geom.width() - diam,
+                   (diam + geom.entryHeight()) / 2.0 - diam);
+
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(nodeStyle.WarningColor.lighter(150));
+    painter->drawEllipse(center, diam * 0.4, diam * 0.4);
+    painter->setBrush(Qt::NoBrush);
+}
+
+void NodePainter::drawProfileOverlay(QPainter *painter,
+                                     NodeGeometry const &geom, Node const &node,
+                                     FlowScene const &scene, bool withText) {
+    if (!scene.isProfileOverlayVisible()) return;
+
+    qint64 const hottest = scene.hottestComputeTime();
+
+    if (hottest <= 0) return;
+
+    NodeProfile const &profile = node.profile();
+
+    double const heat =
+        static_cast<double>(profile.totalNanoseconds) / hottest;
+
+    // 从绿色(不耗时)过渡到红色(最耗时的节点)
+    QColor color = QColor::fromHsvF((1.0 - heat) / 3.0, 1.0, 1.0);
+    color.setAlphaF(0.2 + 0.4 * heat);
+
+    QRectF const rect(0, 0, geom.width(), geom.height());
+
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(color);
+    painter->drawRect(rect);
+    painter->setBrush(Qt::NoBrush);
+
+    if (!withText) return;
+
+    // 累计时间 / 调用次数
+    QString const text =
+        QString("%1 ms / %2")
+            .arg(profile.totalNanoseconds / 1.0e6, 0, 'f', 2)
+            .arg(profile.invocations);
+
+    painter->setPen(Qt::white);
+    painter->drawText(rect, Qt::AlignHCenter | Qt::AlignBottom, text);
+}
+
 void NodePainter::drawValidationRect(QPainter *painter,
                                      NodeGeometry const &geom,
                                      NodeDataModel const *model,
-                                     NodeGraphicsObject const &graphicsObject) {
+                                     NodeGraphicsObject const &graphicsObject,
+                                     bool withText) {
     auto modelValidationState = model->validationState();
 
     if (modelValidationState != NodeValidationState::Valid) {
@@ -344,22 +484,18 @@ void NodePainter::drawValidationRect(QPainter *painter,
 
         painter->drawRoundedRect(boundary, radius, radius);
 
+        if (!withText) return;
+
         painter->setBrush(Qt::gray);
 
         // Drawing the validation message itself
         QString const &errorMsg = model->validationMessage();
 
-        QFont f = painter->font();
-
-        QFontMetrics metrics(f);
-
-        auto rect = metrics.boundingRect(errorMsg);
-
+        // 消息的宽度在 NodeGeometry 中已经用同样的常规字体测量过了
         QPointF position(
-            (geom.width() - rect.width()) / 2.0,
+            (geom.width() - geom.validationTextWidth()) / 2.0,
             geom.height() - (geom.validationHeight() - diam) / 2.0);
 
-        painter->setFont(f);
         painter->setPen(nodeStyle.FontColor);
         painter->drawText(position, errorMsg);
     }
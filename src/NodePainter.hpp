@@ -25,6 +25,16 @@ class NodePainter {
    public:
     static void paint(QPainter *painter, Node &node, FlowScene const &scene);
 
+    /// 缩小到 FlowViewStyle::DetailLevel::Flat 时代替整个节点
+    static void drawFlatNodeRect(QPainter *painter, NodeGeometry const &geom,
+                                 NodeDataModel const *model,
+                                 NodeGraphicsObject const &graphicsObject);
+
+    /// 缩小到 FlowViewStyle::DetailLevel::Dot 时代替整个节点
+    static void drawNodeDot(QPainter *painter, NodeGeometry const &geom,
+                            NodeDataModel const *model,
+                            NodeGraphicsObject const &graphicsObject);
+
     static void drawNodeRect(QPainter *painter, NodeGeometry const &geom,
                              NodeDataModel const *model,
                              NodeGraphicsObject const &graphicsObject);
@@ -41,7 +51,7 @@ class NodePainter {
                                      NodeGeometry const &geom,
                                      NodeState const &state,
                                      NodeDataModel const *model,
-                                     FlowScene const &scene);
+                                     Node const &node, FlowScene const &scene);
 
     static void drawFilledConnectionPoints(QPainter *painter,
                                            NodeGeometry const &geom,
@@ -51,8 +61,19 @@ class NodePainter {
     static void drawResizeRect(QPainter *painter, NodeGeometry const &geom,
                                NodeDataModel const *model);
 
+    static void drawComputingIndicator(QPainter *painter,
+                                       NodeGeometry const &geom,
+                                       NodeState const &state,
+                                       NodeDataModel const *model);
+
+    /// 性能分析的热力图, 按节点的累计计算时间着色
+    static void drawProfileOverlay(QPainter *painter, NodeGeometry const &geom,
+                                   Node const &node, FlowScene const &scene,
+                                   bool withText = true);
+
     static void drawValidationRect(QPainter *painter, NodeGeometry const &geom,
                                    NodeDataModel const *model,
-                                   NodeGraphicsObject const &graphicsObject);
+                                   NodeGraphicsObject const &graphicsObject,
+                                   bool withText = true);
 };
 }  // namespace QtNodes
@@ -0,0 +1,59 @@
+#include "NodeProfiler.hpp"
+
+#include "NodeData.hpp"
+
+using QtNodes::NodeData;
+using QtNodes::NodeProfile;
+using QtNodes::NodeProfiler;
+
+namespace {
+
+/// 当前线程中最内层的计时
+thread_local NodeProfiler::Scope *currentScope = nullptr;
+}  // namespace
+
+NodeProfiler::Scope::Scope(NodeProfiler *profiler, NodeProfile &profile)
+    : _profiler(profiler), _profile(profile) {
+    if (!_profiler) return;
+
+    _parent = currentScope;
+    currentScope = this;
+
+    _timer.start();
+}
+
+NodeProfiler::Scope::~Scope() {
+    if (!_profiler) return;
+
+    qint64 const elapsed = _timer.nsecsElapsed();
+
+    currentScope = _parent;
+
+    if (_parent) _parent->_childNanoseconds += elapsed;
+
+    _profiler->recordCompute(_profile, elapsed - _childNanoseconds);
+}
+
+void NodeProfiler::recordOutput(NodeProfile &profile,
+                                std::shared_ptr<NodeData> const &nodeData,
+                                std::size_t fanOut) {
+    if (nodeData) profile.bytesProduced += nodeData->byteSize();
+
+    profile.transmissions += fanOut;
+}
+
+void NodeProfiler::recordCompute(NodeProfile &profile, qint64 nanoseconds) {
+    ++profile.invocations;
+    profile.totalNanoseconds += nanoseconds;
+
+    if (nanoseconds > profile.maxNanoseconds)
+        profile.maxNanoseconds = nanoseconds;
+
+    // 不同线程可能同时更新不同节点的统计
+    qint64 hottest = _hottestNanoseconds.load(std::memory_order_relaxed);
+
+    while (profile.totalNanoseconds > hottest &&
+           !_hottestNanoseconds.compare_exchange_weak(
+               hottest, profile.totalNanoseconds, std::memory_order_relaxed)) {
+    }
+}
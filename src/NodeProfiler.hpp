@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QtCore/QElapsedTimer>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "NodeProfile.hpp"
+
+namespace QtNodes {
+
+class NodeData;
+
+/// 收集节点的计算统计.
+/// 关闭性能分析时节点没有 profiler, 每次计算只多一次空指针判断
+class NodeProfiler {
+   public:
+    /// 在作用域内计时一次 setInData().
+    /// 嵌套的计时(同步传播触发的下游计算)从外层的时间中扣除
+    class Scope {
+       public:
+        Scope(NodeProfiler *profiler, NodeProfile &profile);
+
+        ~Scope();
+
+        Scope(Scope const &) = delete;
+
+        Scope &operator=(Scope const &) = delete;
+
+       private:
+        NodeProfiler *_profiler;
+
+        NodeProfile &_profile;
+
+        QElapsedTimer _timer;
+
+        Scope *_parent = nullptr;
+
+        qint64 _childNanoseconds = 0;
+    };
+
+    /// 记录一次输出, fanOut 是这次输出传输到的连接数
+    void recordOutput(NodeProfile &profile,
+                      std::shared_ptr<NodeData> const &nodeData,
+                      std::size_t fanOut);
+
+    /// 所有节点中最大的累计计算时间, 用于绘制热力图
+    qint64 hottestNanoseconds() const { return _hottestNanoseconds; }
+
+    void reset() { _hottestNanoseconds = 0; }
+
+   private:
+    void recordCompute(NodeProfile &profile, qint64 nanoseconds);
+
+   private:
+    std::atomic<qint64> _hottestNanoseconds{0};
+};
+}  // namespace QtNodes
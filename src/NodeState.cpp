@@ -1,9 +1,13 @@
 #include "NodeState.hpp"
 
+#include <algorithm>
+
 #include "Connection.hpp"
 #include "NodeDataModel.hpp"
 
 using QtNodes::Connection;
+using QtNodes::DataModelRegistry;
+using QtNodes::Node;
 using QtNodes::NodeDataModel;
 using QtNodes::NodeDataType;
 using QtNodes::NodeState;
@@ -15,9 +19,12 @@ NodeState::NodeState(std::unique_ptr<NodeDataModel> const &model)
       _outConnections(model->nPorts(PortType::Out)),
       _reaction(NOT_REACTING),
       _reactingPortType(PortType::None),
-      _resizing(false) {}
+      _reactingTypeId(DataModelRegistry::InvalidTypeId),
+      _reactingNode(nullptr),
+      _resizing(false),
+      _computing(false) {}
 
-const std::vector<NodeState::ConnectionPtrSet> &NodeState::getEntries(
+const std::vector<NodeState::ConnectionList> &NodeState::getEntries(
     PortType portType) const {
     if (portType == PortType::In)
         return _inConnections;
@@ -25,7 +32,7 @@ const std::vector<NodeState::ConnectionPtrSet> &NodeState::getEntries(
         return _outConnections;
 }
 
-std::vector<NodeState::ConnectionPtrSet> &NodeState::getEntries(
+std::vector<NodeState::ConnectionList> &NodeState::getEntries(
     PortType portType) {
     if (portType == PortType::In)
         return _inConnections;
@@ -33,8 +40,8 @@ std::vector<NodeState::ConnectionPtrSet> &NodeState::getEntries(
         return _outConnections;
 }
 
-NodeState::ConnectionPtrSet NodeState::connections(PortType portType,
-                                                   PortIndex portIndex) const {
+NodeState::ConnectionList const &NodeState::connections(
+    PortType portType, PortIndex portIndex) const {
     auto const &connections = getEntries(portType);
 
     return connections[portIndex];
@@ -42,15 +49,18 @@ NodeState::ConnectionPtrSet NodeState::connections(PortType portType,
 
 void NodeState::setConnection(PortType portType, PortIndex portIndex,
                               Connection &connection) {
-    auto &connections = getEntries(portType);
+    auto &connections = getEntries(portType).at(portIndex);
 
-    connections.at(portIndex).insert(
-        std::make_pair(connection.id(), &connection));
+    if (std::find(connections.begin(), connections.end(), &connection) ==
+        connections.end())
+        connections.push_back(&connection);
 }
 
 void NodeState::eraseConnection(PortType portType, PortIndex portIndex,
-                                QUuid id) {
-    getEntries(portType)[portIndex].erase(id);
+                                Connection const &connection) {
+    auto &connections = getEntries(portType)[portIndex];
+
+    connections.remove(const_cast<Connection *>(&connection));
 }
 
 NodeState::ReactToConnectionState NodeState::reaction() const {
@@ -61,14 +71,26 @@ PortType NodeState::reactingPortType() const { return _reactingPortType; }
 
 NodeDataType NodeState::reactingDataType() const { return _reactingDataType; }
 
+DataModelRegistry::TypeId NodeState::reactingTypeId() const {
+    return _reactingTypeId;
+}
+
+Node const *NodeState::reactingNode() const { return _reactingNode; }
+
 void NodeState::setReaction(ReactToConnectionState reaction,
                             PortType reactingPortType,
-                            NodeDataType reactingDataType) {
+                            NodeDataType reactingDataType,
+                            Node const *reactingNode,
+                            DataModelRegistry::TypeId reactingTypeId) {
     _reaction = reaction;
 
     _reactingPortType = reactingPortType;
 
     _reactingDataType = std::move(reactingDataType);
+
+    _reactingTypeId = reactingTypeId;
+
+    _reactingNode = reactingNode;
 }
 
 bool NodeState::isReacting() const { return _reaction == REACTING; }
@@ -76,3 +98,7 @@ bool NodeState::isReacting() const { return _reaction == REACTING; }
 void NodeState::setResizing(bool resizing) { _resizing = resizing; }
 
 bool NodeState::resizing() const { return _resizing; }
+
+void NodeState::setComputing(bool computing) { _computing = computing; }
+
+bool NodeState::computing() const { return _computing; }
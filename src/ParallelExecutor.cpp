@@ -0,0 +1,228 @@
+#include "ParallelExecutor.hpp"
+
+#include <QtCore/QDebug>
+#include <QtCore/QSignalBlocker>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+#include "Connection.hpp"
+#include "Node.hpp"
+#include "NodeDataModel.hpp"
+#include "NodeProfiler.hpp"
+#include "WorkStealingPool.hpp"
+
+using QtNodes::Connection;
+using QtNodes::Node;
+using QtNodes::NodeData;
+using QtNodes::NodeDataModel;
+using QtNodes::NodeProfiler;
+using QtNodes::ParallelExecutor;
+using QtNodes::PortIndex;
+using QtNodes::PortType;
+using QtNodes::WorkStealingPool;
+
+namespace {
+
+struct NodeTask {
+    Node *node = nullptr;
+
+    /// 尚未完成的上游连接数
+    std::atomic<int> remaining{0};
+
+    /// 计算完成后的输出, 之后只读
+    std::vector<std::shared_ptr<NodeData>> outputs;
+
+    std::vector<std::size_t> successors;
+
+    bool hasInputs = false;
+};
+
+using NodeIndex = std::unordered_map<Node const *, std::size_t>;
+
+void computeNode(std::vector<NodeTask> &tasks, NodeIndex const &index,
+                 std::size_t i) {
+    NodeTask &task = tasks[i];
+    NodeDataModel *model = task.node->nodeDataModel();
+
+    // 数据的传播由执行器负责, 不能让模型的信号再触发一次同步传播
+    QSignalBlocker blocker(model);
+
+    auto const &inEntries = task.node->nodeState().getEntries(PortType::In);
+
+    for (std::size_t port = 0; port < inEntries.size(); ++port) {
+        for (Connection const *c : inEntries[port]) {
+            auto it = index.find(c->getNode(PortType::Out));
+
+            if (it == index.end()) continue;
+
+            auto const &outputs = tasks[it->second].outputs;
+            PortIndex outPort = c->getPortIndex(PortType::Out);
+
+            std::shared_ptr<NodeData> nodeData;
+
+            if (outPort >= 0 &&
+                static_cast<std::size_t>(outPort) < outputs.size())
+                nodeData = outputs[outPort];
+
+            nodeData = c->convertData(std::move(nodeData));
+
+            if (!task.node->inputChanged(nodeData, PortIndex(port))) continue;
+
+            NodeProfiler::Scope scope(task.node->profiler(),
+                                      task.node->profile());
+
+            model->setInData(std::move(nodeData), PortIndex(port));
+        }
+    }
+
+    unsigned int const nOut = model->nPorts(PortType::Out);
+
+    task.outputs.resize(nOut);
+
+    auto const &outEntries = task.node->nodeState().getEntries(PortType::Out);
+
+    for (unsigned int port = 0; port < nOut; ++port) {
+        task.outputs[port] = model->outData(PortIndex(port));
+
+        NodeProfiler *profiler = task.node->profiler();
+
+        if (profiler && port < outEntries.size()) {
+            profiler->recordOutput(task.node->profile(), task.outputs[port],
+                                   outEntries[port].size());
+        }
+    }
+}
+}  // namespace
+
+ParallelExecutor::ParallelExecutor(unsigned int threadCount)
+    : _pool(std::make_unique<WorkStealingPool>(threadCount)) {}
+
+ParallelExecutor::~ParallelExecutor() = default;
+
+unsigned int ParallelExecutor::threadCount() const {
+    return _pool->threadCount();
+}
+
+void ParallelExecutor::run(std::vector<Node *> const &nodes) {
+    NodeIndex index;
+    std::vector<Node *> order;
+
+    order.reserve(nodes.size());
+
+    for (Node *node : nodes) {
+        if (!node) continue;
+
+        index[node] = order.size();
+        order.push_back(node);
+    }
+
+    if (order.empty()) return;
+
+    std::vector<NodeTask> tasks(order.size());
+
+    for (std::size_t i = 0; i < order.size(); ++i) tasks[i].node = order[i];
+
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        for (auto const &connections :
+             order[i]->nodeState().getEntries(PortType::Out)) {
+            for (Connection const *c : connections) {
+                auto it = index.find(c->getNode(PortType::In));
+
+                if (it == index.end()) continue;
+
+                tasks[i].successors.push_back(it->second);
+                tasks[it->second].remaining++;
+                tasks[it->second].hasInputs = true;
+            }
+        }
+    }
+
+    // 有环的图中环上的节点永远不会被释放, 这种情况下直接放弃
+    {
+        std::vector<int> remaining(tasks.size());
+        std::vector<std::size_t> ready;
+
+        for (std::size_t i = 0; i < tasks.size(); ++i) {
+            remaining[i] = tasks[i].remaining;
+            if (remaining[i] == 0) ready.push_back(i);
+        }
+
+        std::size_t released = 0;
+
+        while (!ready.empty()) {
+            std::size_t i = ready.back();
+            ready.pop_back();
+            ++released;
+
+            for (std::size_t next : tasks[i].successors) {
+                if (--remaining[next] == 0) ready.push_back(next);
+            }
+        }
+
+        if (released != tasks.size()) {
+            qWarning() << "Cannot execute a flow graph containing cycles";
+            return;
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable done;
+    std::deque<std::size_t> mainThreadQueue;
+    std::size_t finished = 0;
+
+    std::function<void(std::size_t)> dispatch;
+
+    auto execute = [&](std::size_t i) {
+        computeNode(tasks, index, i);
+
+        for (std::size_t next : tasks[i].successors) {
+            if (tasks[next].remaining.fetch_sub(1) == 1) dispatch(next);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ++finished;
+        done.notify_all();
+    };
+
+    dispatch = [&](std::size_t i) {
+        if (tasks[i].node->nodeDataModel()->threadSafe()) {
+            _pool->submit([&execute, i]() { execute(i); });
+        } else {
+            std::lock_guard<std::mutex> lock(mutex);
+            mainThreadQueue.push_back(i);
+            done.notify_all();
+        }
+    };
+
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+        if (tasks[i].remaining == 0) dispatch(i);
+    }
+
+    // 调用线程负责执行不能离开它的模型, 直到所有节点都完成
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (finished < tasks.size()) {
+            done.wait(lock, [&]() {
+                return !mainThreadQueue.empty() || finished == tasks.size();
+            });
+
+            while (!mainThreadQueue.empty()) {
+                std::size_t i = mainThreadQueue.front();
+                mainThreadQueue.pop_front();
+
+                lock.unlock();
+                execute(i);
+                lock.lock();
+            }
+        }
+    }
+
+    for (NodeTask const &task : tasks) {
+        if (task.hasInputs) task.node->updateGraphics();
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+namespace QtNodes {
+
+class Node;
+
+class WorkStealingPool;
+
+/// 并行地计算整个数据流图.
+/// 一个节点的所有上游节点计算完成后它才会被释放执行.
+/// NodeDataModel::threadSafe() 为真的模型在线程池中计算, 其余模型在调用线程
+/// (GUI线程) 中计算. 全部完成后在调用线程中统一刷新节点的显示.
+/// run() 阻塞调用线程直到整个图计算完, 所以只用于 headless 场景和批量计算,
+/// 交互编辑时的耗时计算由 NodeDataModel::computeAsync() 负责
+class ParallelExecutor {
+   public:
+    /// threadCount 为 0 时使用硬件线程数
+    explicit ParallelExecutor(unsigned int threadCount = 0);
+
+    ~ParallelExecutor();
+
+    /// nodes 需要按依赖顺序排列, 可以含有空指针
+    void run(std::vector<Node *> const &nodes);
+
+    unsigned int threadCount() const;
+
+   private:
+    std::unique_ptr<WorkStealingPool> _pool;
+};
+}  // namespace QtNodes
@@ -0,0 +1,523 @@
+#include "SceneData.hpp"
+
+#include <QtCore/QCborMap>
+#include <QtCore/QCborValue>
+#include <QtCore/QDataStream>
+#include <QtCore/QHash>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonParseError>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThreadPool>
+#include <QtCore/QtGlobal>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "DataModelRegistry.hpp"
+
+using QtNodes::DataModelRegistry;
+using QtNodes::NodeDataType;
+using QtNodes::SceneConnectionRecord;
+using QtNodes::SceneConverterTable;
+using QtNodes::SceneConverterRecord;
+using QtNodes::SceneData;
+using QtNodes::SceneNodeRecord;
+using QtNodes::TypeConverter;
+
+namespace {
+
+char const BinaryMagic[4] = {'Q', 'N', 'F', 'B'};
+
+quint16 const BinaryVersion = 1;
+
+quint32 const NoString = ~quint32(0);
+
+QJsonObject typeToJson(NodeDataType const &type) {
+    QJsonObject typeJson;
+    typeJson["id"] = type.id;
+    typeJson["name"] = type.name;
+
+    return typeJson;
+}
+
+NodeDataType typeFromJson(QJsonObject const &typeJson) {
+    return NodeDataType{typeJson["id"].toString(), typeJson["name"].toString()};
+}
+
+/// 写入时收集字符串, 相同的字符串只存一份
+class StringTable {
+   public:
+    quint32 add(QString const &string) {
+        auto it = _indices.constFind(string);
+
+        if (it != _indices.constEnd()) return it.value();
+
+        auto const index = static_cast<quint32>(_strings.size());
+        _indices.insert(string, index);
+        _strings.push_back(string);
+
+        return index;
+    }
+
+    void write(QDataStream &stream) const {
+        stream << static_cast<quint32>(_strings.size());
+
+        for (QString const &string : _strings) stream << string.toUtf8();
+    }
+
+   private:
+    QHash<QString, quint32> _indices;
+
+    std::vector<QString> _strings;
+};
+
+/// 节点少于这个数时不值得启动线程
+std::size_t const ParallelDecodeThreshold = 256;
+
+/// 每个线程一次取走的节点数
+std::size_t const DecodeChunkSize = 32;
+
+void decodeNode(SceneNodeRecord &record, DataModelRegistry const *registry) {
+    if (!record.encodedModel.isEmpty()) {
+        record.model =
+            QCborValue::fromCbor(record.encodedModel).toMap().toJsonObject();
+        record.model["name"] = record.modelName;
+
+        record.encodedModel.clear();
+    }
+
+    if (!registry) return;
+
+    if (auto parser = registry->payloadParser(record.modelName)) {
+        // 解析失败时模型退回到 unserialize()
+        try {
+            record.payload = (*parser)(record.model);
+        } catch (...) {
+            record.payload.reset();
+        }
+    }
+}
+
+QDataStream &prepare(QDataStream &stream) {
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    return stream;
+}
+}  // namespace
+
+SceneNodeRecord QtNodes::nodeRecordFromJson(QJsonObject const &nodeJson) {
+    SceneNodeRecord record;
+
+    record.id = QUuid(nodeJson["id"].toString());
+
+    QJsonObject const positionJson = nodeJson["position"].toObject();
+    record.position =
+        QPointF(positionJson["x"].toDouble(), positionJson["y"].toDouble());
+
+    record.model = nodeJson["model"].toObject();
+    record.modelName = record.model["name"].toString();
+
+    return record;
+}
+
+SceneConverterTable::SceneConverterTable(SceneData &scene) : _scene(scene) {
+    for (std::size_t i = 0; i < scene.converters.size(); ++i) {
+        SceneConverterRecord const &converter = scene.converters[i];
+        _indices.insert(qMakePair(converter.inType.id, converter.outType.id),
+                        i);
+    }
+}
+
+std::size_t SceneConverterTable::add(NodeDataType const &inType,
+                                     NodeDataType const &outType) {
+    auto const key = qMakePair(inType.id, outType.id);
+    auto it = _indices.constFind(key);
+
+    if (it != _indices.constEnd()) return it.value();
+
+    std::size_t const index = _scene.converters.size();
+    _indices.insert(key, index);
+    _scene.converters.push_back({inType, outType, TypeConverter{}});
+
+    return index;
+}
+
+bool QtNodes::isBinaryScene(QByteArray const &data) {
+    return data.startsWith(QByteArray::fromRawData(BinaryMagic, 4));
+}
+
+bool QtNodes::readJsonScene(QByteArray const &data, SceneData &scene,
+                            DataModelRegistry const *registry) {
+    QJsonParseError error;
+    QJsonDocument const document = QJsonDocument::fromJson(data, &error);
+
+    if (error.error != QJsonParseError::NoError) return false;
+
+    QJsonObject const sceneJson = document.object();
+
+    QJsonArray const nodesJson = sceneJson["nodes"].toArray();
+
+    QHash<QUuid, std::size_t> nodeIndices;
+    nodeIndices.reserve(nodesJson.size());
+
+    scene.nodes.clear();
+    scene.nodes.reserve(nodesJson.size());
+
+    for (QJsonValue const &nodeJson : nodesJson) {
+        scene.nodes.push_back(nodeRecordFromJson(nodeJson.toObject()));
+        nodeIndices.insert(scene.nodes.back().id, scene.nodes.size() - 1);
+    }
+
+    QJsonArray const connectionsJson = sceneJson["connections"].toArray();
+
+    scene.connections.clear();
+    scene.connections.reserve(connectionsJson.size());
+
+    scene.converters.clear();
+    scene.danglingConnections = 0;
+
+    SceneConverterTable converters(scene);
+
+    auto nodeIndex = [&](QJsonValue const &id) {
+        return nodeIndices.value(QUuid(id.toString()),
+                                 SceneConnectionRecord::InvalidIndex);
+    };
+
+    for (QJsonValue const &value : connectionsJson) {
+        QJsonObject const connectionJson = value.toObject();
+
+        SceneConnectionRecord record;
+        record.in = nodeIndex(connectionJson["in_id"]);
+        record.inPort = connectionJson["in_index"].toInt();
+        record.out = nodeIndex(connectionJson["out_id"]);
+        record.outPort = connectionJson["out_index"].toInt();
+
+        QJsonValue const converterJson = connectionJson["converter"];
+
+        if (!converterJson.isUndefined()) {
+            record.converter =
+                converters.add(typeFromJson(converterJson["in"].toObject()),
+                               typeFromJson(converterJson["out"].toObject()));
+        }
+
+        if (record.in == SceneConnectionRecord::InvalidIndex ||
+            record.out == SceneConnectionRecord::InvalidIndex)
+            ++scene.danglingConnections;
+
+        scene.connections.push_back(record);
+    }
+
+    decodeNodes(scene, registry);
+
+    return true;
+}
+
+QByteArray QtNodes::writeJsonScene(SceneData const &scene) {
+    QJsonArray nodesJson;
+
+    for (SceneNodeRecord const &record : scene.nodes) {
+        QJsonObject nodeJson;
+        nodeJson["id"] = record.id.toString();
+        nodeJson["model"] = record.model;
+
+        QJsonObject positionJson;
+        positionJson["x"] = record.position.x();
+        positionJson["y"] = record.position.y();
+        nodeJson["position"] = positionJson;
+
+        nodesJson.append(nodeJson);
+    }
+
+    QJsonArray connectionsJson;
+
+    for (SceneConnectionRecord const &record : scene.connections) {
+        // 与 Connection::serialize() 一样, 不保存不完整的连接
+        if (record.in >= scene.nodes.size() || record.out >= scene.nodes.size())
+            continue;
+
+        QJsonObject connectionJson;
+        connectionJson["in_id"] = scene.nodes[record.in].id.toString();
+        connectionJson["in_index"] = record.inPort;
+        connectionJson["out_id"] = scene.nodes[record.out].id.toString();
+        connectionJson["out_index"] = record.outPort;
+
+        if (record.converter < scene.converters.size()) {
+            SceneConverterRecord const &converter =
+                scene.converters[record.converter];
+
+            QJsonObject converterJson;
+            converterJson["in"] = typeToJson(converter.inType);
+            converterJson["out"] = typeToJson(converter.outType);
+
+            connectionJson["converter"] = converterJson;
+        }
+
+        connectionsJson.append(connectionJson);
+    }
+
+    QJsonObject sceneJson;
+    sceneJson["nodes"] = nodesJson;
+    sceneJson["connections"] = connectionsJson;
+
+    return QJsonDocument(sceneJson).toJson();
+}
+
+bool QtNodes::readBinaryScene(QByteArray const &data, SceneData &scene,
+                              DataModelRegistry const *registry) {
+    if (!isBinaryScene(data)) return false;
+
+    QDataStream stream(data);
+    prepare(stream);
+
+    stream.skipRawData(sizeof(BinaryMagic));
+
+    quint16 version = 0;
+    stream >> version;
+
+    if (version != BinaryVersion) return false;
+
+    quint32 stringCount = 0;
+    stream >> stringCount;
+
+    std::vector<QString> strings;
+
+    // 数量来自文件, 不能直接用来预留空间
+    for (quint32 i = 0; i < stringCount && stream.status() == QDataStream::Ok;
+         ++i) {
+        QByteArray utf8;
+        stream >> utf8;
+        strings.push_back(QString::fromUtf8(utf8));
+    }
+
+    bool valid = true;
+
+    auto string = [&](quint32 index) {
+        if (index < strings.size()) return strings[index];
+
+        valid = false;
+        return QString();
+    };
+
+    quint32 nodeCount = 0;
+    stream >> nodeCount;
+
+    scene.nodes.clear();
+
+    for (quint32 i = 0; i < nodeCount && stream.status() == QDataStream::Ok;
+         ++i) {
+        QByteArray uuid;
+        quint32 modelName = NoString;
+        double x = 0.0;
+        double y = 0.0;
+        QByteArray payload;
+
+        stream >> uuid >> modelName >> x >> y >> payload;
+
+        // 模型数据之后由 decodeNodes() 并行解码
+        SceneNodeRecord record;
+        record.id = QUuid::fromRfc4122(uuid);
+        record.modelName = string(modelName);
+        record.position = QPointF(x, y);
+        record.encodedModel = std::move(payload);
+
+        scene.nodes.push_back(std::move(record));
+    }
+
+    quint32 connectionCount = 0;
+    stream >> connectionCount;
+
+    scene.connections.clear();
+    scene.converters.clear();
+    scene.danglingConnections = 0;
+
+    SceneConverterTable converters(scene);
+
+    auto nodeIndex = [&](quint32 index) {
+        return index < scene.nodes.size() ? index
+                                          : SceneConnectionRecord::InvalidIndex;
+    };
+
+    for (quint32 i = 0;
+         i < connectionCount && stream.status() == QDataStream::Ok; ++i) {
+        quint32 in = 0;
+        qint32 inPort = 0;
+        quint32 out = 0;
+        qint32 outPort = 0;
+        quint32 inTypeId = NoString;
+        quint32 inTypeName = NoString;
+        quint32 outTypeId = NoString;
+        quint32 outTypeName = NoString;
+
+        stream >> in >> inPort >> out >> outPort >> inTypeId >> inTypeName >>
+            outTypeId >> outTypeName;
+
+        SceneConnectionRecord record;
+        record.in = nodeIndex(in);
+        record.inPort = inPort;
+        record.out = nodeIndex(out);
+        record.outPort = outPort;
+
+        if (inTypeId != NoString) {
+            record.converter = converters.add(
+                NodeDataType{string(inTypeId), string(inTypeName)},
+                NodeDataType{string(outTypeId), string(outTypeName)});
+        }
+
+        if (record.in == SceneConnectionRecord::InvalidIndex ||
+            record.out == SceneConnectionRecord::InvalidIndex)
+            ++scene.danglingConnections;
+
+        scene.connections.push_back(record);
+    }
+
+    if (!valid || stream.status() != QDataStream::Ok) return false;
+
+    decodeNodes(scene, registry);
+
+    return true;
+}
+
+QByteArray QtNodes::writeBinaryScene(SceneData const &scene) {
+    StringTable strings;
+
+    // 字符串表要写在最前面, 所以节点和连接先写到另一个缓冲区
+    QByteArray body;
+
+    {
+        QDataStream stream(&body, QIODevice::WriteOnly);
+        prepare(stream);
+
+        stream << static_cast<quint32>(scene.nodes.size());
+
+        for (SceneNodeRecord const &record : scene.nodes) {
+            // 模型名已经在字符串表里了
+            QJsonObject model = record.model;
+            model.remove("name");
+
+            stream << record.id.toRfc4122() << strings.add(record.modelName)
+                   << record.position.x() << record.position.y()
+                   << QCborMap::fromJsonObject(model).toCborValue().toCbor();
+        }
+
+        std::vector<SceneConnectionRecord const *> connections;
+
+        for (SceneConnectionRecord const &record : scene.connections) {
+            if (record.in < scene.nodes.size() &&
+                record.out < scene.nodes.size())
+                connections.push_back(&record);
+        }
+
+        stream << static_cast<quint32>(connections.size());
+
+        for (SceneConnectionRecord const *record : connections) {
+            stream << static_cast<quint32>(record->in)
+                   << static_cast<qint32>(record->inPort)
+                   << static_cast<quint32>(record->out)
+                   << static_cast<qint32>(record->outPort);
+
+            if (record->converter < scene.converters.size()) {
+                SceneConverterRecord const &converter =
+                    scene.converters[record->converter];
+
+                stream << strings.add(converter.inType.id)
+                       << strings.add(converter.inType.name)
+                       << strings.add(converter.outType.id)
+                       << strings.add(converter.outType.name);
+            } else {
+                stream << NoString << NoString << NoString << NoString;
+            }
+        }
+    }
+
+    QByteArray data;
+
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    prepare(stream);
+
+    stream.writeRawData(BinaryMagic, sizeof(BinaryMagic));
+    stream << BinaryVersion;
+
+    strings.write(stream);
+
+    stream.writeRawData(body.constData(), body.size());
+
+    return data;
+}
+
+bool QtNodes::readScene(QByteArray const &data, SceneData &scene,
+                        DataModelRegistry const *registry) {
+    if (isBinaryScene(data)) return readBinaryScene(data, scene, registry);
+
+    return readJsonScene(data, scene, registry);
+}
+
+void QtNodes::decodeNodes(SceneData &scene,
+                          DataModelRegistry const *registry) {
+    // 每一对类型只查找一次
+    if (registry) {
+        for (SceneConverterRecord &converter : scene.converters) {
+            converter.converter =
+                registry->getTypeConverter(converter.outType, converter.inType);
+        }
+    }
+
+    auto &nodes = scene.nodes;
+
+    if (nodes.size() < ParallelDecodeThreshold) {
+        for (SceneNodeRecord &record : nodes) decodeNode(record, registry);
+
+        return;
+    }
+
+    std::atomic<std::size_t> next{0};
+
+    auto decodeChunks = [&]() {
+        std::size_t begin;
+
+        while ((begin = next.fetch_add(DecodeChunkSize)) < nodes.size()) {
+            std::size_t const end =
+                std::min(begin + DecodeChunkSize, nodes.size());
+
+            for (std::size_t i = begin; i < end; ++i)
+                decodeNode(nodes[i], registry);
+        }
+    };
+
+    // 用全局线程池, 不为每次加载创建线程. 调用者 (可能本身就是
+    // SceneLoader 的池线程) 也参与解码, 所以线程池忙时也能完成
+    QThreadPool *pool = QThreadPool::globalInstance();
+
+    std::size_t const chunks =
+        (nodes.size() + DecodeChunkSize - 1) / DecodeChunkSize;
+    std::size_t const helperCount = std::min<std::size_t>(
+        std::max(pool->maxThreadCount() - 1, 0), chunks - 1);
+
+    QSemaphore helpersDone;
+    std::vector<std::unique_ptr<QRunnable> > helpers;
+    helpers.reserve(helperCount);
+
+    for (std::size_t i = 0; i < helperCount; ++i) {
+        helpers.emplace_back(QRunnable::create([&]() {
+            decodeChunks();
+            helpersDone.release();
+        }));
+        helpers.back()->setAutoDelete(false);
+
+        pool->start(helpers.back().get());
+    }
+
+    decodeChunks();
+
+    // 还没开始的任务直接取回, 只等已经开始的那些 (它们很快会发现没有剩余的块)
+    int started = 0;
+
+    for (auto const &helper : helpers) {
+        if (!pool->tryTake(helper.get())) ++started;
+    }
+
+    helpersDone.acquire(started);
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+#include <QtCore/QPair>
+#include <QtCore/QPointF>
+#include <QtCore/QString>
+#include <QtCore/QUuid>
+#include <any>
+#include <cstddef>
+#include <vector>
+
+#include "NodeData.hpp"
+#include "PortType.hpp"
+#include "TypeConverter.hpp"
+
+namespace QtNodes {
+
+class DataModelRegistry;
+
+/// 保存的一个节点
+struct SceneNodeRecord {
+    QUuid id;
+
+    QString modelName;
+
+    QPointF position;
+
+    /// 模型 serialize() 的结果, 其中包含 name
+    QJsonObject model;
+
+    /// 模型注册的 PayloadParser 解析 model 的结果, 交给 NodeDataModel::restore()
+    std::any payload;
+
+    /// 二进制格式中尚未解码的 model, 读取完成后总是为空
+    QByteArray encodedModel;
+};
+
+/// 保存的一个连接, 两端用节点在 SceneData::nodes 中的下标表示
+struct SceneConnectionRecord {
+    static constexpr std::size_t InvalidIndex = ~std::size_t(0);
+
+    /// 引用了不存在的节点时为 InvalidIndex
+    std::size_t in = InvalidIndex;
+    PortIndex inPort = 0;
+
+    std::size_t out = InvalidIndex;
+    PortIndex outPort = 0;
+
+    /// 类型转换器在 SceneData::converters 中的下标, 没有转换器时为
+    /// InvalidIndex
+    std::size_t converter = InvalidIndex;
+};
+
+/// 连接上的类型转换器, 用两端的数据类型表示
+struct SceneConverterRecord {
+    NodeDataType inType;
+    NodeDataType outType;
+
+    /// 给出 registry 时解析场景后就从中查好, 还原连接时不需要再查找
+    TypeConverter converter;
+};
+
+/// 场景文件的中间表示, 与文件格式无关, 也不依赖场景对象.
+/// JSON 和二进制格式都先解析成它, 再由 FlowScene 还原
+struct SceneData {
+    std::vector<SceneNodeRecord> nodes;
+
+    std::vector<SceneConnectionRecord> connections;
+
+    /// 每一对 (输出类型, 输入类型) 只出现一次
+    std::vector<SceneConverterRecord> converters;
+
+    /// 引用了不存在的节点的连接数, 这些连接的 in 或 out 为 InvalidIndex
+    std::size_t danglingConnections = 0;
+
+    /// 连接上的类型转换器, 没有时为空
+    TypeConverter const &converterOf(
+        SceneConnectionRecord const &record) const {
+        static TypeConverter const none;
+
+        return record.converter < converters.size()
+                   ? converters[record.converter].converter
+                   : none;
+    }
+};
+
+/// 向 SceneData::converters 中添加类型转换器, 合并两端类型 id 相同的
+class SceneConverterTable {
+   public:
+    /// 已有的 converters 也会被合并
+    explicit SceneConverterTable(SceneData &scene);
+
+    /// 返回转换器的下标
+    std::size_t add(NodeDataType const &inType, NodeDataType const &outType);
+
+   private:
+    SceneData &_scene;
+
+    QHash<QPair<QString, QString>, std::size_t> _indices;
+};
+
+/// 从 Node::serialize() 格式的 JSON 读取节点
+SceneNodeRecord nodeRecordFromJson(QJsonObject const &nodeJson);
+
+/// 数据是否以二进制场景格式的文件头开始
+bool isBinaryScene(QByteArray const &data);
+
+/// 解析 JSON 场景, 格式与 FlowScene::saveToMemory() 相同.
+/// 连接引用了不存在的节点时, 对应的下标为 InvalidIndex.
+/// 给出 registry 时, 同时用模型注册的 PayloadParser 预先解析模型数据
+bool readJsonScene(QByteArray const &data, SceneData &scene,
+                   DataModelRegistry const *registry = nullptr);
+
+QByteArray writeJsonScene(SceneData const &scene);
+
+/// 二进制格式:
+///   文件头 "QNFB", 版本号
+///   字符串表: 模型名和转换器的类型名, 其他地方只存下标
+///   节点: 16字节 UUID, 模型名下标, 位置, 带长度前缀的模型数据 (CBOR)
+///   连接: 两端节点的下标和端口, 转换器类型的字符串下标
+/// 所有整数都是小端序
+bool readBinaryScene(QByteArray const &data, SceneData &scene,
+                     DataModelRegistry const *registry = nullptr);
+
+QByteArray writeBinaryScene(SceneData const &scene);
+
+/// 根据文件头选择格式解析
+bool readScene(QByteArray const &data, SceneData &scene,
+               DataModelRegistry const *registry = nullptr);
+
+/// 解码每个节点的模型数据并运行 PayloadParser, 再查找类型转换器.
+/// 节点之间互不依赖, 节点较多时分给多个线程. 只由上面的 read 函数调用
+void decodeNodes(SceneData &scene, DataModelRegistry const *registry);
+}  // namespace QtNodes
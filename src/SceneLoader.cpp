@@ -0,0 +1,184 @@
+#include "SceneLoader.hpp"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "BackgroundTask.hpp"
+#include "DataModelRegistry.hpp"
+#include "FlowScene.hpp"
+#include "Node.hpp"
+#include "SceneData.hpp"
+
+using QtNodes::DataModelRegistry;
+using QtNodes::FlowScene;
+using QtNodes::Node;
+using QtNodes::SceneConnectionRecord;
+using QtNodes::SceneData;
+using QtNodes::SceneLoader;
+using QtNodes::SlotHandle;
+using QtNodes::runInBackground;
+
+SceneLoader::SceneLoader(FlowScene &scene) : QObject(&scene), _scene(scene) {
+    // 0 毫秒的定时器在处理完其他事件之后才触发, 每次触发还原一批
+    _timer.setInterval(0);
+
+    connect(&_timer, &QTimer::timeout, this, &SceneLoader::restoreSlice);
+}
+
+SceneLoader::~SceneLoader() = default;
+
+void SceneLoader::load(QString const &fileName) {
+    start([fileName](QString &error) {
+        QFile file(fileName);
+
+        if (!file.open(QIODevice::ReadOnly)) {
+            error = file.errorString();
+            return QByteArray();
+        }
+
+        return file.readAll();
+    });
+}
+
+void SceneLoader::loadFromMemory(QByteArray data) {
+    start([data = std::move(data)](QString &) { return data; });
+}
+
+void SceneLoader::cancel() {
+    if (_loading) finish(Result::Canceled);
+}
+
+bool SceneLoader::isLoading() const { return _loading; }
+
+int SceneLoader::sliceDuration() const { return _sliceDuration; }
+
+void SceneLoader::setSliceDuration(int milliseconds) {
+    _sliceDuration = std::max(milliseconds, 1);
+}
+
+QString SceneLoader::errorString() const { return _errorString; }
+
+void SceneLoader::start(std::function<QByteArray(QString &error)> read) {
+    cancel();
+
+    quint64 const generation = ++_generation;
+
+    _loading = true;
+    _errorString.clear();
+
+    // 加载期间场景可能换了 registry, 解析用开始时的那个
+    std::shared_ptr<DataModelRegistry> registry = _scene._registry;
+
+    runInBackground(
+        this,
+        [registry, read = std::move(read)]() {
+            QString error;
+            auto data = std::make_shared<SceneData>();
+
+            QByteArray const bytes = read(error);
+
+            if (error.isEmpty() && !readScene(bytes, *data, registry.get()))
+                error = QStringLiteral("Cannot read the scene data");
+
+            return std::make_pair(data, error);
+        },
+        [generation](SceneLoader &loader, auto const &parsed) {
+            loader.finishParsing(generation, parsed.first, parsed.second);
+        });
+}
+
+void SceneLoader::finishParsing(quint64 generation,
+                                std::shared_ptr<SceneData> data,
+                                QString const &error) {
+    // 期间加载被取消或者重新开始了
+    if (generation != _generation) return;
+
+    if (!error.isEmpty()) {
+        _errorString = error;
+        finish(Result::Failed);
+        return;
+    }
+
+    _data = std::move(data);
+
+    _danglingConnections = _data->danglingConnections;
+
+    _nodes.clear();
+    _nodes.reserve(_data->nodes.size());
+    _nextConnection = 0;
+
+    Q_EMIT parsed(_data->nodes.size(), _data->connections.size());
+
+    _timer.start();
+}
+
+void SceneLoader::restoreSlice() {
+    QElapsedTimer timer;
+    timer.start();
+
+    auto const &nodeRecords = _data->nodes;
+    auto const &connectionRecords = _data->connections;
+
+    auto sliceOver = [&]() { return timer.elapsed() >= _sliceDuration; };
+
+    try {
+        while (_nodes.size() < nodeRecords.size() && !sliceOver()) {
+            Node &node = _scene.restoreNode(nodeRecords[_nodes.size()]);
+            _nodes.push_back(_scene._nodes.handleOf(node));
+        }
+
+        while (_nodes.size() == nodeRecords.size() &&
+               _nextConnection < connectionRecords.size() && !sliceOver()) {
+            SceneConnectionRecord const &record =
+                connectionRecords[_nextConnection++];
+
+            // 记录中的下标无效, 或者节点在加载期间被删除了
+            Node *nodeIn = record.in < _nodes.size()
+                               ? _scene._nodes.get(_nodes[record.in])
+                               : nullptr;
+            Node *nodeOut = record.out < _nodes.size()
+                                ? _scene._nodes.get(_nodes[record.out])
+                                : nullptr;
+
+            if (!nodeIn || !nodeOut) continue;
+
+            if (!FlowScene::portsInRange(record, *nodeIn, *nodeOut)) {
+                ++_danglingConnections;
+                continue;
+            }
+
+            _scene.createConnection(*nodeIn, record.inPort, *nodeOut,
+                                    record.outPort, _data->converterOf(record));
+        }
+    } catch (std::exception const &e) {
+        _errorString = QString::fromLocal8Bit(e.what());
+        finish(Result::Failed);
+        return;
+    }
+
+    std::size_t const done = _nodes.size() + _nextConnection;
+    std::size_t const total = nodeRecords.size() + connectionRecords.size();
+
+    Q_EMIT progress(done, total);
+
+    if (done == total) {
+        FlowScene::reportDanglingConnections(_danglingConnections);
+        finish(Result::Completed);
+    }
+}
+
+void SceneLoader::finish(Result result) {
+    _timer.stop();
+
+    ++_generation;
+    _loading = false;
+
+    _data.reset();
+    _nodes.clear();
+    _nextConnection = 0;
+
+    Q_EMIT finished(result);
+}
@@ -0,0 +1,143 @@
+#include "SpatialIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using QtNodes::SpatialIndex;
+
+SpatialIndex::SpatialIndex(qreal cellSize) : _cellSize(cellSize) {}
+
+void SpatialIndex::insert(QGraphicsItem *item, QRectF const &sceneRect) {
+    Entry entry;
+    entry.rect = sceneRect.normalized();
+    entry.cells = cellsOf(entry.rect);
+    entry.oversized = entry.cells.cellCount() > MaxCellsPerItem;
+
+    auto it = _entries.find(item);
+
+    if (it != _entries.end()) {
+        // 仍然覆盖同样的格子, 拖动节点时大多是这种情况
+        if (it->second.cells == entry.cells &&
+            it->second.oversized == entry.oversized) {
+            it->second.rect = entry.rect;
+            return;
+        }
+
+        unlink(item, it->second);
+        it->second = entry;
+    } else {
+        _entries.emplace(item, entry);
+    }
+
+    link(item, entry);
+}
+
+void SpatialIndex::remove(QGraphicsItem *item) {
+    auto it = _entries.find(item);
+
+    if (it == _entries.end()) return;
+
+    unlink(item, it->second);
+    _entries.erase(it);
+}
+
+void SpatialIndex::clear() {
+    _cells.clear();
+    _entries.clear();
+    _oversized.clear();
+}
+
+std::vector<QGraphicsItem *> SpatialIndex::items(QRectF const &area) const {
+    std::vector<QGraphicsItem *> result;
+
+    QRectF const rect = area.normalized();
+    CellRange const range = cellsOf(rect);
+
+    auto intersects = [&rect](QRectF const &r) {
+        // 与 QRectF::intersects 不同, 宽或高为 0 的矩形也算相交
+        return r.left() <= rect.right() && rect.left() <= r.right() &&
+               r.top() <= rect.bottom() && rect.top() <= r.bottom();
+    };
+
+    for (int y = range.top; y <= range.bottom; ++y) {
+        for (int x = range.left; x <= range.right; ++x) {
+            auto cell = _cells.find(cellKey(x, y));
+
+            if (cell == _cells.end()) continue;
+
+            for (QGraphicsItem *item : cell->second) {
+                Entry const &entry = _entries.at(item);
+
+                // 图元覆盖多个格子时, 只在它与查询区域重叠的第一个格子中报告
+                if (x != std::max(range.left, entry.cells.left) ||
+                    y != std::max(range.top, entry.cells.top))
+                    continue;
+
+                if (intersects(entry.rect)) result.push_back(item);
+            }
+        }
+    }
+
+    for (QGraphicsItem *item : _oversized) {
+        if (intersects(_entries.at(item).rect)) result.push_back(item);
+    }
+
+    return result;
+}
+
+std::vector<QGraphicsItem *> SpatialIndex::items(QPointF const &point) const {
+    return items(QRectF(point, QSizeF(0.0, 0.0)));
+}
+
+SpatialIndex::CellRange SpatialIndex::cellsOf(QRectF const &rect) const {
+    CellRange range;
+    range.left = cellCoordinate(rect.left());
+    range.top = cellCoordinate(rect.top());
+    range.right = cellCoordinate(rect.right());
+    range.bottom = cellCoordinate(rect.bottom());
+
+    return range;
+}
+
+int SpatialIndex::cellCoordinate(qreal value) const {
+    // 限制范围, 避免极大的坐标转换成 int 时溢出
+    qreal const limit = qreal(1 << 30);
+
+    return int(std::clamp(std::floor(value / _cellSize), -limit, limit));
+}
+
+quint64 SpatialIndex::cellKey(int x, int y) {
+    return (quint64(quint32(x)) << 32) | quint32(y);
+}
+
+void SpatialIndex::link(QGraphicsItem *item, Entry const &entry) {
+    if (entry.oversized) {
+        _oversized.push_back(item);
+        return;
+    }
+
+    for (int y = entry.cells.top; y <= entry.cells.bottom; ++y) {
+        for (int x = entry.cells.left; x <= entry.cells.right; ++x)
+            _cells[cellKey(x, y)].push_back(item);
+    }
+}
+
+void SpatialIndex::unlink(QGraphicsItem *item, Entry const &entry) {
+    if (entry.oversized) {
+        _oversized.erase(
+            std::find(_oversized.begin(), _oversized.end(), item));
+        return;
+    }
+
+    for (int y = entry.cells.top; y <= entry.cells.bottom; ++y) {
+        for (int x = entry.cells.left; x <= entry.cells.right; ++x) {
+            auto cell = _cells.find(cellKey(x, y));
+
+            if (cell == _cells.end()) continue;
+
+            cell->second.remove(item);
+
+            if (cell->second.empty()) _cells.erase(cell);
+        }
+    }
+}
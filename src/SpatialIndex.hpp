@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QtCore/QPointF>
+#include <QtCore/QRectF>
+#include <QtCore/QtGlobal>
+#include <unordered_map>
+#include <vector>
+
+#include "SmallVector.hpp"
+
+class QGraphicsItem;
+
+namespace QtNodes {
+
+/// 场景中节点和连接的均匀网格索引.
+/// 每个图元按场景中的包围盒登记到它覆盖的所有格子中, 查询只访问与区域
+/// 相交的格子, 不需要遍历场景中的所有图元.
+/// 拖动节点时包围盒通常仍然落在原来的格子里, 这时只更新记录的矩形
+class SpatialIndex {
+   public:
+    explicit SpatialIndex(qreal cellSize = 256.0);
+
+    /// 登记图元或者更新它的包围盒
+    void insert(QGraphicsItem *item, QRectF const &sceneRect);
+
+    void remove(QGraphicsItem *item);
+
+    void clear();
+
+    /// 包围盒与 area 相交的图元, 每个只出现一次, 顺序不确定
+    std::vector<QGraphicsItem *> items(QRectF const &area) const;
+
+    /// 包围盒包含 point 的图元
+    std::vector<QGraphicsItem *> items(QPointF const &point) const;
+
+   private:
+    /// 包围盒覆盖的格子, 闭区间
+    struct CellRange {
+        int left = 0;
+        int top = 0;
+        int right = -1;
+        int bottom = -1;
+
+        bool operator==(CellRange const &other) const {
+            return left == other.left && top == other.top &&
+                   right == other.right && bottom == other.bottom;
+        }
+
+        bool operator!=(CellRange const &other) const {
+            return !(*this == other);
+        }
+
+        qint64 cellCount() const {
+            return qint64(right - left + 1) * (bottom - top + 1);
+        }
+    };
+
+    struct Entry {
+        QRectF rect;
+
+        CellRange cells;
+
+        /// 覆盖的格子太多, 放在 _oversized 中而不是格子里
+        bool oversized = false;
+    };
+
+    /// 一个图元最多登记到这么多格子中, 更大的图元每次查询都检查
+    static constexpr qint64 MaxCellsPerItem = 1024;
+
+    CellRange cellsOf(QRectF const &rect) const;
+
+    int cellCoordinate(qreal value) const;
+
+    static quint64 cellKey(int x, int y);
+
+    void link(QGraphicsItem *item, Entry const &entry);
+
+    void unlink(QGraphicsItem *item, Entry const &entry);
+
+   private:
+    qreal _cellSize;
+
+    std::unordered_map<quint64, SmallVector<QGraphicsItem *, 4> > _cells;
+
+    std::unordered_map<QGraphicsItem *, Entry> _entries;
+
+    std::vector<QGraphicsItem *> _oversized;
+};
+}  // namespace QtNodes
@@ -0,0 +1,173 @@
+#include "TopologicalOrder.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "Connection.hpp"
+#include "Node.hpp"
+
+using QtNodes::Connection;
+using QtNodes::Node;
+using QtNodes::PortType;
+using QtNodes::TopologicalOrder;
+
+namespace {
+
+template <typename Visitor>
+void forEachNeighbour(Node const &node, PortType portType,
+                      Visitor const &visitor) {
+    PortType const opposite = oppositePort(portType);
+
+    for (auto const &connections : node.nodeState().getEntries(portType)) {
+        for (Connection const *c : connections) {
+            if (Node *next = c->getNode(opposite)) visitor(next);
+        }
+    }
+}
+}  // namespace
+
+void TopologicalOrder::addNode(Node &node) {
+    _position[&node] = _order.size();
+    _order.push_back(&node);
+}
+
+void TopologicalOrder::removeNode(Node const &node) {
+    auto it = _position.find(&node);
+
+    if (it == _position.end()) return;
+
+    _order[it->second] = nullptr;
+    _position.erase(it);
+
+    ++_holes;
+
+    if (_holes > 64 && _holes > _order.size() / 2) compact();
+}
+
+bool TopologicalOrder::addEdge(Node &from, Node &to) {
+    if (&from == &to) return false;
+
+    std::size_t const upperBound = position(from);
+    std::size_t const lowerBound = position(to);
+
+    // 顺序已经满足
+    if (upperBound < lowerBound) return true;
+
+    // 从 to 向下游搜索 [lowerBound, upperBound] 区间内的节点
+    std::vector<Node *> forward;
+    std::unordered_set<Node *> visited;
+    std::vector<Node *> stack{&to};
+
+    visited.insert(&to);
+
+    while (!stack.empty()) {
+        Node *node = stack.back();
+        stack.pop_back();
+
+        forward.push_back(node);
+
+        bool cycle = false;
+
+        forEachNeighbour(*node, PortType::Out, [&](Node *next) {
+            if (next == &from) cycle = true;
+
+            if (position(*next) <= upperBound && visited.insert(next).second)
+                stack.push_back(next);
+        });
+
+        if (cycle) return false;
+    }
+
+    // 从 from 向上游搜索同一区间内的节点
+    std::vector<Node *> backward;
+    stack.push_back(&from);
+    visited.insert(&from);
+
+    while (!stack.empty()) {
+        Node *node = stack.back();
+        stack.pop_back();
+
+        backward.push_back(node);
+
+        forEachNeighbour(*node, PortType::In, [&](Node *prev) {
+            if (position(*prev) >= lowerBound && visited.insert(prev).second)
+                stack.push_back(prev);
+        });
+    }
+
+    // 把受影响的节点重新放进它们原来占用的位置:
+    // 上游的节点整体排在下游的节点之前, 各自内部保持原有的相对顺序
+    auto byPosition = [this](Node const *a, Node const *b) {
+        return position(*a) < position(*b);
+    };
+
+    std::sort(forward.begin(), forward.end(), byPosition);
+    std::sort(backward.begin(), backward.end(), byPosition);
+
+    std::vector<std::size_t> slots;
+    slots.reserve(forward.size() + backward.size());
+
+    for (Node const *node : backward) slots.push_back(position(*node));
+    for (Node const *node : forward) slots.push_back(position(*node));
+
+    std::sort(slots.begin(), slots.end());
+
+    auto slot = slots.begin();
+
+    for (auto const *nodes : {&backward, &forward}) {
+        for (Node *node : *nodes) {
+            _order[*slot] = node;
+            _position[node] = *slot;
+            ++slot;
+        }
+    }
+
+    return true;
+}
+
+bool TopologicalOrder::wouldCreateCycle(Node const &from,
+                                        Node const &to) const {
+    if (&from == &to) return true;
+
+    std::size_t const upperBound = position(from);
+
+    if (upperBound < position(to)) return false;
+
+    std::unordered_set<Node const *> visited{&to};
+    std::vector<Node const *> stack{&to};
+
+    bool cycle = false;
+
+    while (!stack.empty() && !cycle) {
+        Node const *node = stack.back();
+        stack.pop_back();
+
+        forEachNeighbour(*node, PortType::Out, [&](Node *next) {
+            if (next == &from) cycle = true;
+
+            if (position(*next) < upperBound && visited.insert(next).second)
+                stack.push_back(next);
+        });
+    }
+
+    return cycle;
+}
+
+void TopologicalOrder::clear() {
+    _order.clear();
+    _position.clear();
+    _holes = 0;
+}
+
+std::size_t TopologicalOrder::position(Node const &node) const {
+    return _position.at(&node);
+}
+
+void TopologicalOrder::compact() {
+    auto end = std::remove(_order.begin(), _order.end(), nullptr);
+    _order.erase(end, _order.end());
+
+    for (std::size_t i = 0; i < _order.size(); ++i) _position[_order[i]] = i;
+
+    _holes = 0;
+}
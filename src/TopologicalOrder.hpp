@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace QtNodes {
+
+class Node;
+
+/// 增量维护的节点拓扑顺序 (Pearce–Kelly 动态拓扑排序).
+/// 新建连接时只重排受影响区间内的节点, 删除连接不会破坏已有的顺序.
+/// 删除节点只在数组中留下空洞, 空洞过多时再统一压缩.
+class TopologicalOrder {
+   public:
+    void addNode(Node &node);
+
+    void removeNode(Node const &node);
+
+    /// 连接 from -> to 已经建立后调用.
+    /// 如果这条连接产生了环则返回 false, 此时顺序保持不变.
+    bool addEdge(Node &from, Node &to);
+
+    /// 新建连接 from -> to 是否会形成环.
+    /// 当前顺序中 from 排在 to 前面时不可能形成环, 直接返回;
+    /// 否则只在两者之间的区间内搜索 to 的下游.
+    bool wouldCreateCycle(Node const &from, Node const &to) const;
+
+    void clear();
+
+    /// 按依赖顺序排列的节点, 其中可能含有空指针(已删除节点留下的空洞)
+    std::vector<Node *> const &nodes() const { return _order; }
+
+    /// 节点在依赖顺序中的位置, 上游节点的位置总是更小
+    std::size_t position(Node const &node) const;
+
+   private:
+    void compact();
+
+   private:
+    std::vector<Node *> _order;
+
+    std::unordered_map<Node const *, std::size_t> _position;
+
+    std::size_t _holes = 0;
+};
+}  // namespace QtNodes
@@ -0,0 +1,107 @@
+#include "WorkStealingPool.hpp"
+
+#include <algorithm>
+
+using QtNodes::WorkStealingPool;
+
+namespace {
+// 当前线程所属的线程池以及它在池中的编号
+thread_local WorkStealingPool const *currentPool = nullptr;
+thread_local unsigned int currentIndex = 0;
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(unsigned int threadCount) {
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    _workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i)
+        _workers.push_back(std::make_unique<Worker>());
+
+    _threads.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i)
+        _threads.emplace_back([this, i]() { run(i); });
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _stopping = true;
+    }
+
+    _wakeUp.notify_all();
+
+    for (auto &thread : _threads) thread.join();
+}
+
+void WorkStealingPool::submit(Task task) {
+    unsigned int index = (currentPool == this)
+                             ? currentIndex
+                             : _nextQueue++ % threadCount();
+
+    // 先计数再放入队列: 任务一放进去就可能被取走并减少计数
+    _pending++;
+
+    {
+        std::lock_guard<std::mutex> lock(_workers[index]->mutex);
+        _workers[index]->tasks.push_back(std::move(task));
+    }
+
+    // 加锁保证等待中的线程不会错过这次唤醒
+    { std::lock_guard<std::mutex> lock(_sleepMutex); }
+
+    _wakeUp.notify_one();
+}
+
+void WorkStealingPool::run(unsigned int index) {
+    currentPool = this;
+    currentIndex = index;
+
+    for (;;) {
+        Task task;
+
+        if (popLocal(index, task) || steal(index, task)) {
+            _pending--;
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+
+        _wakeUp.wait(lock, [this]() { return _stopping || _pending > 0; });
+
+        if (_stopping && _pending == 0) return;
+    }
+}
+
+bool WorkStealingPool::popLocal(unsigned int index, Task &task) {
+    Worker &worker = *_workers[index];
+
+    std::lock_guard<std::mutex> lock(worker.mutex);
+
+    if (worker.tasks.empty()) return false;
+
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+
+    return true;
+}
+
+bool WorkStealingPool::steal(unsigned int thief, Task &task) {
+    unsigned int const n = threadCount();
+
+    for (unsigned int i = 1; i < n; ++i) {
+        Worker &victim = *_workers[(thief + i) % n];
+
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (victim.tasks.empty()) continue;
+
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+
+        return true;
+    }
+
+    return false;
+}
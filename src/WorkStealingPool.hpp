@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace QtNodes {
+
+/// 工作窃取线程池.
+/// 每个工作线程有自己的任务队列, 在自己的线程里提交的任务放进自己队列的尾部
+/// 并优先执行(LIFO), 空闲的线程从其他队列的头部偷任务(FIFO).
+class WorkStealingPool {
+   public:
+    using Task = std::function<void()>;
+
+    /// threadCount 为 0 时使用硬件线程数
+    explicit WorkStealingPool(unsigned int threadCount = 0);
+
+    WorkStealingPool(WorkStealingPool const &) = delete;
+
+    WorkStealingPool &operator=(WorkStealingPool const &) = delete;
+
+    /// 等待所有已提交的任务执行完毕后退出
+    ~WorkStealingPool();
+
+    void submit(Task task);
+
+    unsigned int threadCount() const {
+        return static_cast<unsigned int>(_workers.size());
+    }
+
+   private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(unsigned int index);
+
+    bool popLocal(unsigned int index, Task &task);
+
+    bool steal(unsigned int thief, Task &task);
+
+   private:
+    std::vector<std::unique_ptr<Worker>> _workers;
+
+    std::vector<std::thread> _threads;
+
+    std::mutex _sleepMutex;
+
+    std::condition_variable _wakeUp;
+
+    /// 所有队列中尚未被取走的任务数
+    std::atomic<std::size_t> _pending{0};
+
+    std::atomic<unsigned int> _nextQueue{0};
+
+    bool _stopping = false;
+};
+}  // namespace QtNodes